@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace appimagelauncher {
+
+struct AppImageEntry {
+    std::string id;
+    std::string name;
+    std::filesystem::path storedPath;
+    std::filesystem::path originalPath;
+    bool autostart = false;
+
+    // Read from the AppImage's embedded .desktop file when it is added, so listings never
+    // have to reopen the binary. Empty when the AppImage does not provide them.
+    std::string version;
+    std::string categories;
+    std::string comment;
+    std::string iconName;
+
+    // ContentHash of the stored file, recorded on import or by dedupe(); empty for entries
+    // added before hashes were recorded. Stored AppImages with equal hashes share an inode.
+    std::string contentHash;
+
+    // AppImageFormat of the stored file, recorded on import; 0 for entries added before
+    // formats were recorded.
+    int appImageType = 0;
+    std::uint32_t machine = 0;
+    std::uint64_t payloadOffset = 0;
+
+    // Number of the kept version (see AppImageManager::versions()) that storedPath is; 0
+    // while no versions are kept.
+    unsigned activeVersion = 0;
+
+    // Absolute, lexically normalised forms of the paths above. Derived when the entry is
+    // loaded or added and used as lookup keys; never persisted.
+    std::filesystem::path normalizedStoredPath;
+    std::filesystem::path normalizedOriginalPath;
+};
+
+} // namespace appimagelauncher
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QSortFilterProxyModel>
+
+namespace appimagelauncher {
+
+class AppImageListModel;
+
+// Shows the rows of an AppImageListModel that match the search query, in the source
+// order. Matching is answered by the source model's search index.
+class AppImageFilterModel : public QSortFilterProxyModel {
+    Q_OBJECT
+public:
+    explicit AppImageFilterModel(AppImageListModel *source, QObject *parent = nullptr);
+
+    void setQuery(const QString &query);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    AppImageListModel *m_source;
+};
+
+} // namespace appimagelauncher
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QCollator>
+#include <QCollatorSortKey>
+#include <QHash>
+#include <QIcon>
+#include <QVector>
+
+#include "AppImageManager/AppImageManager.h"
+#include "AppImageManager/Preferences.h"
+#include "AppImageManager/SearchIndex.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace appimagelauncher {
+
+class IconCache;
+
+// Managed AppImages sorted by display name. The window reports each mutation it makes
+// through AppImageManager, and the model turns it into a single row insert, remove, move
+// or dataChanged, so views keep their selection and scroll position. Changes made by
+// other processes arrive through syncWithManager(), which applies them the same way.
+// Icons are only requested from the IconCache when a view asks for a row's decoration.
+class AppImageListModel : public QAbstractListModel {
+    Q_OBJECT
+public:
+    enum Role {
+        IdRole = Qt::UserRole,
+        AutostartRole
+    };
+
+    AppImageListModel(AppImageManager &manager, IconCache *iconCache, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // Re-reads every entry from the manager.
+    void reload();
+    void entryAdded(const AppImageEntry &entry);
+    void entryChanged(const std::string &id);
+    void entryRemoved(const std::string &id);
+    // Diffs the rows against the manager's entries and the files on disk and applies only
+    // the differences.
+    void syncWithManager();
+
+    void setViewMode(ViewMode mode);
+    // Refreshes translated display text after a language change.
+    void retranslate();
+
+    QModelIndex indexForId(const QString &id) const;
+
+    // The search index follows every mutation before the model signals it, so a filter
+    // proxy evaluating new or changed rows sees their current match state.
+    void setQuery(const QString &query);
+    bool rowMatchesQuery(int row) const;
+
+private slots:
+    void onIconReady(const QString &id);
+
+private:
+    // Each entry keeps the collation key of its display name, computed when it is loaded,
+    // added or renamed, so ordering rows is a plain key comparison.
+    struct Row {
+        AppImageEntry entry;
+        QCollatorSortKey sortKey;
+        // Files removed behind the manager's back, e.g. from a file manager.
+        bool storedFileMissing = false;
+        bool autostartFileMissing = false;
+    };
+
+    Row makeRow(AppImageEntry entry) const;
+    void updateFileState(Row &row) const;
+    static bool storedFileMissing(const AppImageEntry &entry);
+    bool autostartFileMissing(const AppImageEntry &entry) const;
+    void removeEntryRow(int row);
+    static bool rowLess(const Row &lhs, const Row &rhs);
+    int rowForId(const std::string &id) const;
+    // Records the current position of rows first to last in m_rowById.
+    void indexRows(int first, int last);
+    void emitRowsChanged(const QVector<int> &roles);
+    QString decoratedName(const Row &row) const;
+    QString toolTip(const Row &row) const;
+    QIcon placeholderAvatar(const AppImageEntry &entry) const;
+
+private:
+    AppImageManager &m_manager;
+    IconCache *m_iconCache;
+    ViewMode m_viewMode;
+    QCollator m_collator;
+    std::vector<Row> m_rows;
+    // Row of each id, kept in step with m_rows so lookups by id do not scan the list.
+    std::unordered_map<std::string, int> m_rowById;
+    SearchIndex m_searchIndex;
+    mutable QHash<QString, QIcon> m_placeholderAvatars;
+};
+
+} // namespace appimagelauncher
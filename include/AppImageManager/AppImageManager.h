@@ -1,28 +1,98 @@
 #pragma once
 
+#include "AppImageManager/AppImageEntry.h"
+#include "AppImageManager/AppImageMetadata.h"
+#include "AppImageManager/AppImageValidator.h"
+#include "AppImageManager/DeltaUpdater.h"
+#include "AppImageManager/ImportEngine.h"
+#include "AppImageManager/ManifestStore.h"
+#include "AppImageManager/StorageReconciler.h"
+
+#include <cstdint>
 #include <filesystem>
 #include <map>
 #include <optional>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace appimagelauncher {
 
-struct AppImageEntry {
-    std::string id;
-    std::string name;
-    std::filesystem::path storedPath;
-    std::filesystem::path originalPath;
-    bool autostart = false;
-};
-
 class AppImageManager {
 public:
+    // Scoped batch: mutations made while it is alive are persisted together on commit()
+    // and rolled back if it is destroyed without committing.
+    class Batch {
+    public:
+        explicit Batch(AppImageManager &manager);
+        ~Batch();
+
+        Batch(const Batch &) = delete;
+        Batch &operator=(const Batch &) = delete;
+
+        void commit();
+
+    private:
+        AppImageManager &m_manager;
+        bool m_finished = false;
+    };
+
+    // An import split so its file I/O can run off the thread that owns the manager.
+    // prepareImport() validates the file (see validateAppImage()) and picks a storage name,
+    // performImport() moves the file and reads its metadata without touching any manager,
+    // and finishImport() registers the entry.
+    // performImport() never replaces an existing file: if the picked name was taken in the
+    // meantime it moves on to the next suffix and updates storedPath.
+    struct PreparedImport {
+        std::filesystem::path source;
+        std::filesystem::path absoluteSource;
+        std::filesystem::path storedPath;
+        bool moveToStorage = true;
+        // storedPath is storageStem + ("-" + storageSuffix, unless 0) + storageExtension.
+        std::string storageStem;
+        std::string storageExtension;
+        unsigned storageSuffix = 0;
+        AppImageFormat format;
+        AppImageMetadata metadata;
+        std::string contentHash;
+    };
+
+    struct DedupeResult {
+        std::size_t hashed = 0;
+        std::size_t linked = 0;
+        std::uint64_t reclaimedBytes = 0;
+    };
+
+    struct RepairResult {
+        std::size_t repaired = 0;
+        // Issues that no longer applied, or could not be repaired, when repairStorage() got to them.
+        std::size_t skipped = 0;
+        std::uint64_t reclaimedBytes = 0;
+    };
+
+    // A build of an entry kept under versionsDirectory(id) as "<number>-<content hash>.AppImage".
+    // The active one is a hardlink of the entry's storedPath, so keeping it costs nothing.
+    struct Version {
+        unsigned number = 0;
+        std::filesystem::path path;
+        std::string contentHash;
+        bool active = false;
+    };
+
+    // Versions kept per entry by addVersion() and updateAppImage(), the active one included.
+    static constexpr std::size_t kRetainedVersions = 3;
+
     AppImageManager();
     explicit AppImageManager(std::filesystem::path baseDirectory);
 
     void load();
-    void save() const;
+    void save();
+    // Reloads when another process has written the manifest since the last load. Every
+    // mutation also catches up under the manifest lock before it applies, so changes made
+    // by other processes are never overwritten with stale data.
+    bool reloadIfChanged();
 
     const std::filesystem::path &baseDirectory() const noexcept;
     const std::filesystem::path &storageDirectory() const noexcept;
@@ -33,32 +103,133 @@ public:
     std::optional<AppImageEntry> entryByStoredPath(const std::filesystem::path &path) const;
     std::optional<AppImageEntry> entryByOriginalPath(const std::filesystem::path &path) const;
 
-    AppImageEntry addAppImage(const std::filesystem::path &path, bool moveToStorage = true);
+    // Moving across filesystems copies through the import engine, reporting to progress.
+    AppImageEntry addAppImage(
+        const std::filesystem::path &path, bool moveToStorage = true, const ImportProgress &progress = {});
+    PreparedImport prepareImport(const std::filesystem::path &path, bool moveToStorage = true);
+    static void performImport(PreparedImport &import, const ImportProgress &progress = {});
+    AppImageEntry finishImport(const PreparedImport &import);
     void removeAppImage(const std::string &id);
     void renameAppImage(const std::string &id, const std::string &displayName);
 
+    // Entries whose AppImage has the same content hash, in id order.
+    std::vector<AppImageEntry> duplicatesOf(const std::string &id) const;
+    // Hashes entries added before content hashes were recorded, then hardlinks stored
+    // AppImages with identical content to a single inode. Imports do the latter as they go.
+    DedupeResult dedupe();
+    // Replaces the stored AppImage with the version described by a local zsync mirror (see
+    // buildDeltaUpdate()), reusing the blocks it already has. The new file becomes a new
+    // version of the entry, so rollback() undoes the update; a build that is already kept is
+    // activated instead, and one identical to the active file is up to date. Not available
+    // inside a batch.
+    DeltaUpdateResult updateAppImage(const std::string &id, const std::string &source);
+
+    // Versions of one application grouped under a single entry. addVersion() moves a newer
+    // build in as the next version and activates it; the previous file is kept as a version
+    // first and shares identical blocks with the new one where the filesystem allows. A build
+    // whose content is already kept is activated instead and path is left where it is.
+    // Switching versions hardlinks the chosen one over storedPath with rename(), so it is
+    // atomic and copies nothing; the entry's metadata, format and hash follow it while its
+    // id, display name and autostart setting stay. None of these run inside a batch.
+    std::filesystem::path versionsDirectory(const std::string &id) const;
+    std::vector<Version> versions(const std::string &id) const;
+    AppImageEntry addVersion(const std::string &id, const std::filesystem::path &path, const ImportProgress &progress = {});
+    AppImageEntry activateVersion(const std::string &id, unsigned number);
+    // Activates the newest version older than the active one.
+    AppImageEntry rollback(const std::string &id);
+    // Deletes the oldest versions beyond keep, never the active one. Returns how many went.
+    std::size_t pruneVersions(const std::string &id, std::size_t keep);
+
+    // Finds files in storage and autostart entries the manifest does not account for and
+    // entries whose files are gone (see scanStorage()). repairStorage() fixes what a report
+    // lists in one batch, holding the manifest lock throughout and checking each issue again
+    // first, so an old report never undoes later changes. Untracked AppImages are registered
+    // in place rather than deleted. Not available inside a batch.
+    StorageReport checkStorage(const StorageScanProgress &progress = {}) const;
+    RepairResult repairStorage(const StorageReport &report);
+
     bool isAutostartEnabled(const std::string &id) const;
     void setAutostart(const std::string &id, bool enabled);
 
     std::filesystem::path autostartDirectory() const noexcept;
+    std::filesystem::path autostartDesktopPath(const std::string &id) const;
+
+    // While a batch is open, manifest writes, autostart file updates and deletion of
+    // removed AppImages are deferred until commitBatch(). rollbackBatch() restores the
+    // library and moves imported files back to where they came from.
+    void beginBatch();
+    void commitBatch();
+    void rollbackBatch();
+    bool inBatch() const noexcept { return m_batch.has_value(); }
 
     std::filesystem::path manifestPath() const;
+    // Touched by every manifest write from any process; the file to watch for changes.
+    std::filesystem::path manifestLockPath() const;
+    // Where launches are recorded (see LaunchHistory).
+    std::filesystem::path launchHistoryPath() const;
+    std::filesystem::path exportManifest(const std::filesystem::path &path = {}) const;
 
 private:
+    struct PendingBatch {
+        EntryMap snapshot;
+        std::set<std::string> changedIds;
+        std::set<std::string> autostartIds;
+        std::vector<std::pair<std::filesystem::path, std::filesystem::path>> importedFiles;
+        std::vector<std::filesystem::path> removedFiles;
+    };
+
     std::filesystem::path ensureBaseDirectory(std::filesystem::path baseDirectory);
     void ensureStorageDirectory();
     std::filesystem::path ensureAutostartDirectory(std::filesystem::path directory) const;
-    std::string generateId(const std::filesystem::path &path) const;
-    std::filesystem::path autostartDesktopPath(const std::string &id) const;
+    std::string generateId(const std::filesystem::path &path);
+    void scanStorageNames();
+    void noteStorageName(const std::string &stem, const std::string &extension, unsigned suffix);
+    ManifestStore::Lock lockForUpdate();
+    void persistEntry(const AppImageEntry &entry);
+    void persistRemoval(const std::string &id);
+    void persistChanges(const std::set<std::string> &ids);
+    void rebaseBatch(PendingBatch &batch);
     void writeAutostartEntry(const AppImageEntry &entry) const;
     void removeAutostartEntry(const std::string &id) const;
+    void syncAutostartEntry(const std::string &id) const;
+    void rebuildIndexes();
+    void indexEntry(const AppImageEntry &entry);
+    void unindexEntry(const AppImageEntry &entry);
+    std::optional<AppImageEntry> lookupIndexed(const std::unordered_multimap<std::string, std::string> &index,
+        const std::filesystem::path &path) const;
+    void restoreBatch(PendingBatch &batch);
+    bool isInStorage(const AppImageEntry &entry) const;
+    AppImageEntry &entryForVersionChange(const std::string &id);
+    Version retainActiveVersion(AppImageEntry &entry);
+    bool activateKeptVersion(AppImageEntry &entry, const std::string &contentHash);
+    Version storeVersion(const std::string &id, const std::filesystem::path &source, const std::string &contentHash,
+        const ImportProgress &progress);
+    void switchToVersion(AppImageEntry &entry, const Version &version);
+    std::size_t pruneVersions(AppImageEntry &entry, std::size_t keep);
+    bool repairIssue(const StorageIssue &issue);
+    const AppImageEntry *sharedStoredFileFor(const AppImageEntry &entry) const;
 
 private:
     std::filesystem::path m_baseDirectory;
     std::filesystem::path m_storageDirectory;
-    std::filesystem::path m_manifestPath;
+    ManifestStore m_manifest;
     std::filesystem::path m_autostartDirectory;
-    std::map<std::string, AppImageEntry> m_entries;
+    EntryMap m_entries;
+    std::uint64_t m_loadedGeneration = 0;
+    // Normalised path -> id. Multimaps because nothing prevents two entries from sharing
+    // an original path (the same download imported twice).
+    std::unordered_multimap<std::string, std::string> m_storedPathIndex;
+    std::unordered_multimap<std::string, std::string> m_originalPathIndex;
+    // Content hash -> id, for entries whose hash is known.
+    std::unordered_multimap<std::string, std::string> m_contentHashIndex;
+    std::optional<PendingBatch> m_batch;
+    // Next free suffix per id base ("foo" -> 3 when foo, foo-1 and foo-2 exist), so new
+    // ids are picked without probing. Rebuilt with the indexes.
+    std::unordered_map<std::string, unsigned> m_nextIdSuffix;
+    // The same per (stem, extension) of the files in storage, filled by one directory scan
+    // on the first import. Only a hint: placement itself refuses to replace files.
+    std::map<std::pair<std::string, std::string>, unsigned> m_nextStorageSuffix;
+    bool m_storageNamesScanned = false;
 };
 
 } // namespace appimagelauncher
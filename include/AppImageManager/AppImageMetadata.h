@@ -0,0 +1,25 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace appimagelauncher {
+
+// Values from the [Desktop Entry] group of the .desktop file an AppImage carries at the
+// root of its payload. Missing keys are left empty.
+struct AppImageMetadata {
+    std::string name;
+    std::string version;     // X-AppImage-Version
+    std::string categories;  // Raw "Categories" list, e.g. "Utility;Development;"
+    std::string comment;
+    std::string icon;
+};
+
+AppImageMetadata parseDesktopEntry(std::string_view contents);
+
+// Reads the metadata without executing the AppImage. AppImages that have no readable
+// payload or no .desktop file yield empty metadata rather than an error.
+AppImageMetadata readAppImageMetadata(const std::filesystem::path &path);
+
+} // namespace appimagelauncher
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace appimagelauncher {
+
+// Structural facts about an AppImage, read from a few hundred bytes of it without
+// executing or mounting anything.
+struct AppImageFormat {
+    // 1 (an ISO 9660 image that is also an ELF executable) or 2 (an ELF runtime followed
+    // by a SquashFS payload).
+    int type = 0;
+    // ELF e_machine of the runtime, e.g. 62 for x86_64.
+    std::uint32_t machine = 0;
+    // Where the filesystem image starts; 0 for type 1, whose whole file is the image.
+    std::uint64_t payloadOffset = 0;
+    std::uint64_t payloadSize = 0;
+    // Where the SquashFS inode, directory and fragment tables start, relative to
+    // payloadOffset; they run to the end of the payload. 0 for type 1.
+    std::uint64_t metadataOffset = 0;
+};
+
+// Checks the ELF header, the AppImage magic ("AI" and the type at offset 8) and the
+// SquashFS or ISO 9660 superblock, including that the payload fits in the file. Throws
+// std::runtime_error naming the first problem found.
+AppImageFormat validateAppImage(const std::filesystem::path &path);
+
+// "x86_64", "aarch64" and so on; "machine N" for machines without a name here.
+std::string machineName(std::uint32_t machine);
+
+} // namespace appimagelauncher
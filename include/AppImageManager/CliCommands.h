@@ -0,0 +1,29 @@
+#pragma once
+
+#include "AppImageManager/AppImageManager.h"
+
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace appimagelauncher {
+
+// Returned by runCliCommand for commands that need Qt (currently only "open").
+constexpr int kRequiresQtExitCode = -1;
+
+// Command-line commands that only need AppImageManager, so they run without any Qt
+// initialisation. They write to the given streams rather than std::cout/std::cerr so the
+// launcher daemon can relay their output, and return the process exit code. Arguments
+// exclude the program name; for the run*Command helpers they also exclude the command.
+void printUsage(std::ostream &out);
+int runCliCommand(const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err);
+
+// Expands directory arguments to the AppImages they directly contain, in a stable order.
+std::vector<std::filesystem::path> collectAppImagePaths(const std::vector<std::string> &arguments);
+
+int runListCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err);
+int runSearchCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err);
+int runAutostartCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err);
+
+} // namespace appimagelauncher
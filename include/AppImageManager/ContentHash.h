@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+namespace appimagelauncher {
+
+constexpr std::size_t kContentHashChunkSize = 4u << 20;
+
+// Identifies an AppImage by content: the SHA-256 of the concatenated SHA-256 digests of
+// its kContentHashChunkSize chunks followed by its size as a little-endian uint64, in hex.
+// Chunks are hashed on up to `threads` threads (0 picks one per core, at most 8).
+std::string contentHash(const unsigned char *data, std::size_t size, unsigned threads = 0);
+// Hashes a memory-mapped copy of the file. Throws std::runtime_error if it cannot be read.
+std::string contentHashOfFile(const std::filesystem::path &path, unsigned threads = 0);
+
+} // namespace appimagelauncher
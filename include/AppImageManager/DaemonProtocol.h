@@ -0,0 +1,42 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace appimagelauncher {
+
+// Wire format shared by the launcher daemon and the command-line client. A request is a
+// single line of tab-separated fields: the client's working directory, then the command
+// and its arguments. The reply is a header line "<exit code>\t<stdout length>" followed
+// by the command's stdout and then its stderr. Plain POSIX so the client path never has
+// to initialise Qt.
+
+// Exit code telling the client to handle the command itself, e.g. when opening an
+// unmanaged AppImage needs an interactive prompt.
+constexpr int kDaemonFallbackExitCode = -1;
+
+struct DaemonRequest {
+    std::filesystem::path workingDirectory;
+    std::vector<std::string> arguments;
+};
+
+struct DaemonReply {
+    int exitCode = 0;
+    std::string out;
+    std::string err;
+};
+
+std::filesystem::path daemonSocketPath();
+
+std::optional<std::string> encodeDaemonRequest(const DaemonRequest &request);
+DaemonRequest decodeDaemonRequest(std::string_view line);
+std::string encodeDaemonReply(const DaemonReply &reply);
+
+// Sends one request to a running daemon. Returns std::nullopt when no daemon is listening
+// or the arguments cannot be encoded, so the caller should handle the command in-process.
+std::optional<DaemonReply> requestDaemon(const std::vector<std::string> &arguments);
+
+} // namespace appimagelauncher
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace appimagelauncher {
+
+struct DeltaUpdateResult {
+    // The zsync control file used and the new AppImage it describes, from which the
+    // blocks missing locally were read.
+    std::filesystem::path controlFile;
+    std::filesystem::path targetFile;
+    std::uint64_t targetSize = 0;
+    std::uint64_t reusedBytes = 0;
+    std::uint64_t fetchedBytes = 0;
+    // The current file already is the target; nothing was written.
+    bool upToDate = false;
+};
+
+// The update information embedded in an AppImage's .upd_info ELF section, e.g.
+// "zsync|https://example.org/Foo-latest-x86_64.AppImage.zsync" or
+// "gh-releases-zsync|user|repo|latest|Foo-*x86_64.AppImage.zsync". Empty when there is none.
+std::optional<std::string> readUpdateInformation(const std::filesystem::path &appImage);
+
+// Reconstructs the AppImage described by a zsync control file into output (which must not
+// exist), zsync style: the control file's block checksums are looked up while a rolling
+// checksum slides over current, matching blocks are copied from current and only the rest
+// is read from the new AppImage. The result is checked against the control file's SHA-1.
+//
+// source is local: a .zsync file, or a directory mirroring the update server in which the
+// control file named by updateInformation is looked up; a file:// prefix is accepted. The
+// new AppImage is the control file's URL resolved against the control file's directory,
+// or a file of that name next to it when the URL is remote. Throws std::runtime_error.
+DeltaUpdateResult buildDeltaUpdate(const std::filesystem::path &current, const std::string &updateInformation,
+    const std::string &source, const std::filesystem::path &output);
+
+} // namespace appimagelauncher
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+namespace appimagelauncher {
+
+// Owns a file descriptor and closes it on destruction. An fd below zero (a failed open())
+// is held as is, so callers check get() before using it.
+class FileDescriptor {
+public:
+    explicit FileDescriptor(int fd)
+        : m_fd(fd)
+    {
+    }
+    ~FileDescriptor()
+    {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+    FileDescriptor(const FileDescriptor &) = delete;
+    FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+    int get() const noexcept { return m_fd; }
+    // Hands the descriptor to the caller, for instance to check what close() returns.
+    int release() noexcept
+    {
+        const int fd = m_fd;
+        m_fd = -1;
+        return fd;
+    }
+
+private:
+    int m_fd;
+};
+
+// "<what> <path>: <strerror(errno)>"; call it before anything else can change errno.
+inline std::runtime_error ioError(const std::string &what, const std::filesystem::path &path)
+{
+    return std::runtime_error(what + " " + path.string() + ": " + std::strerror(errno));
+}
+
+} // namespace appimagelauncher
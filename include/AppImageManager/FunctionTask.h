@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QRunnable>
+
+#include <functional>
+#include <utility>
+
+namespace appimagelauncher {
+
+// Runs a callable on a QThreadPool; the pool deletes the task once it has run.
+class FunctionTask : public QRunnable {
+public:
+    explicit FunctionTask(std::function<void()> function)
+        : m_function(std::move(function))
+    {
+    }
+
+    void run() override { m_function(); }
+
+private:
+    std::function<void()> m_function;
+};
+
+} // namespace appimagelauncher
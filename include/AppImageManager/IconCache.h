@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QHash>
+#include <QIcon>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+#include "AppImageManager/AppImageEntry.h"
+
+QT_BEGIN_NAMESPACE
+class QImage;
+QT_END_NAMESPACE
+
+namespace appimagelauncher {
+
+// Application icons read from each AppImage's embedded .DirIcon with SquashFsReader, without
+// running the AppImage. Reading runs on a worker pool and results are kept in an on-disk thumbnail cache keyed by path, size and
+// modification time, so the GUI thread never blocks on it.
+class IconCache : public QObject {
+    Q_OBJECT
+public:
+    explicit IconCache(QObject *parent = nullptr);
+    ~IconCache() override;
+
+    // Returns the icon when it is already known for the entry's content hash. Otherwise returns
+    // the icon of the build it replaced, or a null icon, schedules a read and emits iconReady()
+    // for the entry once it completes.
+    QIcon icon(const AppImageEntry &entry);
+
+signals:
+    void iconReady(const QString &id);
+
+private:
+    void onExtracted(const QString &id, const QString &path, const QString &contentHash, const QImage &image);
+
+    // Updates and version switches replace the file behind a stored path, so what is kept in
+    // memory per path only holds for the content hash it was read from.
+    struct CachedIcon {
+        QString contentHash;
+        QIcon icon;
+    };
+
+private:
+    QString m_cacheDirectory;
+    QHash<QString, CachedIcon> m_icons;
+    // Stored path and content hash of reads in flight.
+    QSet<QString> m_pending;
+    // Content hash per stored path of AppImages without an icon.
+    QHash<QString, QString> m_missing;
+    QThreadPool m_pool;
+};
+
+} // namespace appimagelauncher
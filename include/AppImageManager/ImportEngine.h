@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+
+namespace appimagelauncher {
+
+// Called after each copied chunk with the bytes copied so far and the total; returning
+// false cancels the import.
+using ImportProgress = std::function<bool(std::uint64_t copied, std::uint64_t total)>;
+
+enum class ImportMethod {
+    Rename,
+    Reflink,
+    CopyFileRange,
+    Sendfile,
+    BufferedCopy
+};
+
+struct ImportResult {
+    ImportMethod method = ImportMethod::Rename;
+    std::uint64_t bytes = 0;
+    // Where the file was placed; moveForImport() may pick a later candidate.
+    std::filesystem::path destination;
+};
+
+// Destination names to try in order, attempt 0 first; an empty path means no more.
+using DestinationCandidates = std::function<std::filesystem::path(unsigned attempt)>;
+
+// Thrown when the progress callback cancels; the partial destination is already removed.
+class ImportCancelled : public std::runtime_error {
+public:
+    ImportCancelled()
+        : std::runtime_error("Import cancelled")
+    {
+    }
+};
+
+// Copies source to a destination that must not exist yet, trying a FICLONE reflink
+// first, then copy_file_range, sendfile and finally a large-buffer read/write loop. The
+// copy keeps the source's permission bits, is fsynced and has its size verified; on any
+// failure the partial destination is removed.
+ImportResult copyForImport(const std::filesystem::path &source, const std::filesystem::path &destination,
+    const ImportProgress &progress = {});
+
+// Moves source to the first candidate that is free, never replacing an existing file:
+// renameat2(RENAME_NOREPLACE) when both are on one filesystem, otherwise a copyForImport
+// into a private temporary name that is then placed the same way. The source is removed
+// only once the copy is durable.
+ImportResult moveForImport(const std::filesystem::path &source, const DestinationCandidates &candidates,
+    const ImportProgress &progress = {});
+// As above with a single destination; throws if it already exists.
+ImportResult moveForImport(const std::filesystem::path &source, const std::filesystem::path &destination,
+    const ImportProgress &progress = {});
+
+// Asks the filesystem to store blocks that are identical at the same offsets in reference
+// and copy only once (FIDEDUPERANGE), e.g. for successive versions of an AppImage. The
+// kernel compares each range again before sharing it. Returns the bytes now shared; 0 on
+// filesystems without extent sharing.
+std::uint64_t shareIdenticalBlocks(const std::filesystem::path &reference, const std::filesystem::path &copy);
+
+const char *importMethodName(ImportMethod method);
+
+} // namespace appimagelauncher
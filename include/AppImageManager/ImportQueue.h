@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include "AppImageManager/AppImageManager.h"
+
+#include <memory>
+
+namespace appimagelauncher {
+
+// Imports AppImages on a worker thread, one job at a time in the order they were queued.
+// The manager is only touched on the thread that owns the queue: the storage name is
+// picked when a job is queued and the entry is registered once its copy completes, so
+// copying the next file overlaps with registering the previous one.
+class ImportQueue : public QObject {
+    Q_OBJECT
+public:
+    explicit ImportQueue(AppImageManager &manager, QObject *parent = nullptr);
+    // Cancels outstanding jobs and waits for the worker; copies that already completed are
+    // still registered.
+    ~ImportQueue() override;
+
+    // Returns the job id. Throws std::runtime_error when the file cannot be queued.
+    quint64 enqueue(const QString &path, bool moveToStorage);
+    // A job whose copy has already completed is registered regardless.
+    void cancel(quint64 job);
+    int pendingCount() const { return m_jobs.size(); }
+
+signals:
+    void jobQueued(quint64 job, const QString &fileName);
+    // Emitted from the worker thread; receivers on other threads get it queued.
+    void jobProgress(quint64 job, qint64 copied, qint64 total);
+    void jobFinished(quint64 job, const QString &id);
+    void jobFailed(quint64 job, const QString &fileName, const QString &message);
+    void jobCancelled(quint64 job);
+
+private:
+    struct Job;
+
+    void onJobDone(quint64 job);
+    AppImageEntry registerJob(Job &job);
+
+private:
+    AppImageManager &m_manager;
+    quint64 m_nextJob;
+    QHash<quint64, std::shared_ptr<Job>> m_jobs;
+    QThreadPool m_pool;
+};
+
+} // namespace appimagelauncher
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+QT_BEGIN_NAMESPACE
+class QSocketNotifier;
+QT_END_NAMESPACE
+
+namespace appimagelauncher {
+
+// Watches a drop folder such as ~/Downloads with inotify and reports AppImages once they
+// are complete: written and closed (IN_CLOSE_WRITE) or renamed into place (IN_MOVED_TO),
+// which is how browsers finish a download. Files must pass validateAppImage();
+// anything else saved there is ignored. Arrivals within a short window are reported
+// together so a burst of downloads becomes one batch of imports.
+class InboxWatcher : public QObject {
+    Q_OBJECT
+public:
+    explicit InboxWatcher(QObject *parent = nullptr);
+    ~InboxWatcher() override;
+
+    // Replaces the watched directory; an empty path stops watching. Throws
+    // std::runtime_error when the directory cannot be watched.
+    void setDirectory(const QString &directory);
+    QString directory() const { return m_directory; }
+
+signals:
+    void appImagesArrived(const QStringList &paths);
+
+private:
+    void stop();
+    void onReadable();
+    void flush();
+
+private:
+    QString m_directory;
+    int m_inotifyFd;
+    QSocketNotifier *m_notifier;
+    QTimer m_batchTimer;
+    QStringList m_pending;
+};
+
+} // namespace appimagelauncher
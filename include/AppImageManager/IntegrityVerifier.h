@@ -0,0 +1,53 @@
+#pragma once
+
+#include "AppImageManager/AppImageEntry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace appimagelauncher {
+
+enum class VerifyStatus {
+    Ok,
+    Mismatch,
+    Missing,
+    Unreadable,
+    // Imported before content hashes were recorded; `dedupe` records them.
+    NotHashed,
+    // No longer a structurally valid AppImage (see validateAppImage()).
+    Invalid
+};
+
+struct VerifyResult {
+    std::string id;
+    std::filesystem::path storedPath;
+    VerifyStatus status = VerifyStatus::Ok;
+    std::string actualHash;
+    std::string error;
+};
+
+struct VerifyReport {
+    std::vector<VerifyResult> results;
+    std::uint64_t bytesHashed = 0;
+    double seconds = 0.0;
+    bool cancelled = false;
+
+    std::size_t failureCount() const;
+    double gigabytesPerSecond() const;
+};
+
+// Called after each entry with the number of entries done; returning false cancels.
+using VerifyProgress = std::function<bool(std::size_t done, std::size_t total)>;
+
+// Validates each entry's stored file, then re-hashes it with contentHashOfFile() and
+// compares it with the recorded hash. Hardlinked duplicates are hashed once. Only reads
+// the given entries, so it can run on any thread.
+VerifyReport verifyEntries(const std::vector<AppImageEntry> &entries, const VerifyProgress &progress = {});
+
+const char *verifyStatusName(VerifyStatus status);
+
+} // namespace appimagelauncher
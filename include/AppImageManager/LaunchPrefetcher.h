@@ -0,0 +1,83 @@
+#pragma once
+
+#include "AppImageManager/AppImageEntry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace appimagelauncher {
+
+// AppImages warmed by `prefetch` and when the daemon starts.
+constexpr std::size_t kDefaultPrefetchCount = 5;
+
+struct LaunchStats {
+    std::string id;
+    std::size_t launches = 0;
+    // Launches that found less than half of the AppImage in the page cache.
+    std::size_t coldLaunches = 0;
+    // Mean fraction of the AppImage that was cached at launch.
+    double meanResidency = 0.0;
+    // Unix time of the latest launch.
+    std::int64_t lastLaunch = 0;
+    // Launches weighted by age with a half-life of a week; what "hottest" is ranked by.
+    double score = 0.0;
+};
+
+// Append-only log of launches, one "<unix time>\t<id>\t<residency>" line each. Several
+// processes may record at once: lines are appended whole under an advisory lock, and the log
+// drops its older half when it grows past a few hundred kilobytes.
+class LaunchHistory {
+public:
+    explicit LaunchHistory(std::filesystem::path path);
+
+    // Never throws; a launch must not fail because its history could not be written.
+    void record(const std::string &id, double residency) const noexcept;
+    // Hottest first.
+    std::vector<LaunchStats> stats() const;
+
+private:
+    std::filesystem::path m_path;
+};
+
+struct PrefetchResult {
+    std::string id;
+    std::filesystem::path path;
+    std::uint64_t fileBytes = 0;
+    // Cached before prefetching.
+    std::uint64_t residentBytes = 0;
+    // Handed to the kernel to read ahead.
+    std::uint64_t requestedBytes = 0;
+    std::string error;
+
+    double residency() const;
+};
+
+// How much of the file the page cache holds, from mincore() over a mapping of it.
+PrefetchResult pageCacheResidency(const std::filesystem::path &path);
+
+// What warming may add to the page cache: a quarter of MemAvailable, so it never pushes out
+// the working set. 0 when /proc/meminfo cannot be read.
+std::uint64_t prefetchBudget();
+
+// Asks the kernel with posix_fadvise(POSIX_FADV_WILLNEED) to read the pages of an AppImage
+// that are not cached yet, up to maxBytes of them: first the runtime and the SquashFS
+// superblock, then the SquashFS tables at the end of the payload, then the file data, which
+// is the order a launch reads them in. Returns once the reads are queued.
+PrefetchResult prefetchAppImage(const std::filesystem::path &path, std::uint64_t maxBytes);
+
+// Warms the count hottest entries in history order within budget bytes.
+std::vector<PrefetchResult> prefetchHottest(const std::vector<AppImageEntry> &entries, const LaunchHistory &history,
+    std::size_t count, std::uint64_t budget);
+
+// Called right before an AppImage is started: prefetches it within prefetchBudget() and
+// records the launch with how much of it was cached beforehand. Warming is skipped when
+// APPIMAGEMANAGER_NO_PREFETCH is set. Never throws.
+void prepareLaunch(const std::filesystem::path &historyPath, const AppImageEntry &entry) noexcept;
+
+// Whether APPIMAGEMANAGER_NO_PREFETCH disables warming.
+bool prefetchDisabled();
+
+} // namespace appimagelauncher
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QObject>
+
+#include "AppImageManager/AppImageManager.h"
+#include "AppImageManager/DaemonProtocol.h"
+
+#include <iosfwd>
+
+QT_BEGIN_NAMESPACE
+class QLocalServer;
+class QLocalSocket;
+QT_END_NAMESPACE
+
+namespace appimagelauncher {
+
+// Resident process that keeps the manager, its indexes and the translations loaded and
+// serves open/list/autostart requests from the command-line client over a Unix socket.
+// Once listening it warms the page cache for the most launched AppImages.
+class LauncherDaemon : public QObject {
+    Q_OBJECT
+public:
+    explicit LauncherDaemon(AppImageManager &manager, QObject *parent = nullptr);
+
+    bool listen(QString *errorMessage);
+
+private slots:
+    void onNewConnection();
+
+private:
+    void onReadyRead(QLocalSocket *socket);
+    DaemonReply handleRequest(const DaemonRequest &request);
+    int openTarget(const DaemonRequest &request, std::ostream &err);
+
+private:
+    AppImageManager &m_manager;
+    QLocalServer *m_server;
+};
+
+} // namespace appimagelauncher
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+#include "AppImageManager/AppImageManager.h"
+
+namespace appimagelauncher {
+
+// Notices changes made to the library outside this process: manifest writes by the CLI
+// or another window (every write touches the manifest lock file), AppImages added to or
+// deleted from the storage directory, and autostart entries edited by hand. Bursts of
+// events, such as a batch import, are coalesced into a single libraryChanged().
+class LibraryWatcher : public QObject {
+    Q_OBJECT
+public:
+    explicit LibraryWatcher(const AppImageManager &manager, QObject *parent = nullptr);
+
+signals:
+    void libraryChanged();
+
+private:
+    void onPathChanged();
+    void watchPaths();
+
+private:
+    QFileSystemWatcher m_watcher;
+    QTimer m_debounce;
+    QStringList m_paths;
+};
+
+} // namespace appimagelauncher
@@ -1,15 +1,24 @@
 #pragma once
 
+#include <QHash>
 #include <QMainWindow>
+#include <QThreadPool>
 
 #include "AppImageManager/AppImageManager.h"
+#include "AppImageManager/IconCache.h"
 #include "AppImageManager/Preferences.h"
 #include "AppImageManager/TranslationManager.h"
 
+#include <atomic>
+
 QT_BEGIN_NAMESPACE
-class QListWidget;
+class QDragEnterEvent;
+class QDropEvent;
+class QLineEdit;
+class QProgressBar;
+class QToolButton;
+class QListView;
 class QAction;
-class QListWidgetItem;
 class QMenu;
 class QToolBar;
 class QActionGroup;
@@ -17,16 +26,26 @@ QT_END_NAMESPACE
 
 namespace appimagelauncher {
 
+class AppImageFilterModel;
+class AppImageListModel;
+class ImportQueue;
+class InboxWatcher;
+class LibraryWatcher;
+struct VerifyReport;
+
 class MainWindow : public QMainWindow {
     Q_OBJECT
 public:
     MainWindow(AppImageManager &manager, TranslationManager &translator, Preferences preferences, QWidget *parent = nullptr);
+    ~MainWindow() override;
 
     Preferences preferences() const { return m_preferences; }
     void applyPreferences(const Preferences &preferences);
 
 protected:
     void changeEvent(QEvent *event) override;
+    void dragEnterEvent(QDragEnterEvent *event) override;
+    void dropEvent(QDropEvent *event) override;
 
 private slots:
     void onAddAppImage();
@@ -36,7 +55,16 @@ private slots:
     void onToggleAutostart();
     void onRenameSelected();
     void onOpenPreferences();
+    void onVerifyLibrary();
+    void onCleanUpStorage();
     void onContextMenuRequested(const QPoint &position);
+    void updateStatusMessage();
+    void onImportQueued(quint64 job, const QString &fileName);
+    void onImportProgress(quint64 job, qint64 copied, qint64 total);
+    void onImportFinished(quint64 job, const QString &id);
+    void onImportFailed(quint64 job, const QString &fileName, const QString &message);
+    void onLibraryChanged();
+    void onInboxArrivals(const QStringList &paths);
 
 private:
     void createUi();
@@ -44,19 +72,35 @@ private:
     void createToolBar();
     void retranslateUi();
     void applyViewMode();
-    void refreshEntries();
-    void rebuildItem(QListWidgetItem *item, const AppImageEntry &entry);
-    QIcon avatarForEntry(const AppImageEntry &entry) const;
-    QString decoratedName(const AppImageEntry &entry) const;
     void updateActionsForSelection();
     std::optional<AppImageEntry> selectedEntry() const;
     void promptAutostartFailure(const std::exception &error);
+    void enqueueImports(const QStringList &paths);
+    void watchInbox();
+    void removeImportIndicator(quint64 job);
+    void onVerifyFinished(const VerifyReport &report);
+    void onStorageCheckFinished(const StorageReport &report, const QString &error);
+
+    // A status bar progress bar with a cancel button for one queued import.
+    struct ImportIndicator {
+        QWidget *widget = nullptr;
+        QProgressBar *progressBar = nullptr;
+        QToolButton *cancelButton = nullptr;
+    };
 
 private:
     AppImageManager &m_manager;
     TranslationManager &m_translationManager;
     Preferences m_preferences;
-    QListWidget *m_listWidget;
+    IconCache *m_iconCache;
+    AppImageListModel *m_model;
+    AppImageFilterModel *m_filterModel;
+    ImportQueue *m_importQueue;
+    LibraryWatcher *m_libraryWatcher;
+    InboxWatcher *m_inboxWatcher;
+    QHash<quint64, ImportIndicator> m_importIndicators;
+    QLineEdit *m_searchEdit;
+    QListView *m_listView;
     QAction *m_addAction;
     QAction *m_removeAction;
     QAction *m_openAction;
@@ -64,6 +108,8 @@ private:
     QAction *m_autostartAction;
     QAction *m_renameAction;
     QAction *m_settingsAction;
+    QAction *m_verifyAction;
+    QAction *m_cleanUpAction;
     QAction *m_quitAction;
     QAction *m_viewListAction;
     QAction *m_viewGridAction;
@@ -72,6 +118,11 @@ private:
     QMenu *m_viewMenu;
     QMenu *m_preferencesMenu;
     QActionGroup *m_viewActions;
+    QProgressBar *m_verifyProgress;
+    QProgressBar *m_storageProgress;
+    // Library-wide background work such as verification; cancelled and drained on close.
+    QThreadPool m_backgroundPool;
+    std::atomic_bool m_cancelBackgroundTasks;
 };
 
 } // namespace appimagelauncher
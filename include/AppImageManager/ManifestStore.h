@@ -0,0 +1,98 @@
+#pragma once
+
+#include "AppImageManager/AppImageEntry.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+namespace appimagelauncher {
+
+using EntryMap = std::map<std::string, AppImageEntry>;
+
+// Thrown by readBinary() for a manifest that can be read but not parsed, such as a damaged
+// file or one written in a newer format.
+class CorruptManifestError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Persists the managed library as a versioned binary manifest (a header, fixed-size
+// records and one shared string table) that is memory-mapped on load. Installs that
+// still only have the legacy tab-separated manifest are migrated on first load.
+//
+// Individual mutations are appended to a checksummed journal that is replayed on top
+// of the base manifest; save() compacts both into a new base via temp-file-and-rename.
+//
+// Several processes may share a manifest. Writers hold a Lock (flock on manifest.lock)
+// and every write bumps a generation counter kept in that file, so a process can tell
+// cheaply whether what it loaded is still current.
+class ManifestStore {
+public:
+    // Exclusive while alive. Nests within one store, so callers can hold a lock across a
+    // read-modify-write cycle while the store takes its own around each write.
+    class Lock {
+    public:
+        Lock() = default;
+        explicit Lock(const ManifestStore &store);
+        Lock(Lock &&other) noexcept;
+        Lock &operator=(Lock &&) = delete;
+        ~Lock();
+
+    private:
+        const ManifestStore *m_store = nullptr;
+    };
+
+    explicit ManifestStore(const std::filesystem::path &baseDirectory);
+    ~ManifestStore();
+    ManifestStore(const ManifestStore &) = delete;
+    ManifestStore &operator=(const ManifestStore &) = delete;
+
+    const std::filesystem::path &path() const noexcept { return m_path; }
+    const std::filesystem::path &journalPath() const noexcept { return m_journalPath; }
+    const std::filesystem::path &legacyPath() const noexcept { return m_legacyPath; }
+    const std::filesystem::path &lockPath() const noexcept { return m_lockPath; }
+
+    // A corrupt base manifest is moved aside as manifest.bin.corrupt-<unix time> with a warning
+    // on stderr, and the library is rebuilt from the legacy manifest, if any, and the journal.
+    EntryMap load() const;
+    void save(const EntryMap &entries) const;
+    // Changes with every write by any process; a single pread, cheap enough to poll.
+    std::uint64_t generation() const;
+
+    // Append a single mutation to the journal. Returns true once the journal has grown
+    // large enough that the caller should compact it with save().
+    bool recordPut(const AppImageEntry &entry) const;
+    bool recordErase(const std::string &id) const;
+    // Journal the current state of every id in one write: a put for ids present in
+    // entries, an erase for the rest.
+    bool recordChanges(const EntryMap &entries, const std::set<std::string> &ids) const;
+
+    static EntryMap readBinary(const std::filesystem::path &path);
+    static void writeBinary(const std::filesystem::path &path, const EntryMap &entries);
+    static EntryMap readTsv(const std::filesystem::path &path);
+    static void writeTsv(const std::filesystem::path &path, const EntryMap &entries);
+
+private:
+    bool appendJournal(const std::string &records) const;
+    void replayJournal(EntryMap &entries) const;
+    EntryMap recoverCorruptManifest(const CorruptManifestError &error) const;
+    bool openLockFile() const;
+    void lock() const;
+    void unlock() const;
+    void bumpGeneration() const;
+
+private:
+    std::filesystem::path m_path;
+    std::filesystem::path m_journalPath;
+    std::filesystem::path m_legacyPath;
+    std::filesystem::path m_lockPath;
+    // Opened on first use; the lock is held while m_lockDepth > 0.
+    mutable int m_lockFd = -1;
+    mutable int m_lockDepth = 0;
+};
+
+} // namespace appimagelauncher
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace appimagelauncher {
+
+// Read-only memory mapping of a whole file. An empty file maps to an empty view.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::filesystem::path &path);
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const unsigned char *data() const noexcept { return m_data; }
+    std::size_t size() const noexcept { return m_size; }
+    std::string_view view() const noexcept { return { reinterpret_cast<const char *>(m_data), m_size }; }
+
+private:
+    void reset() noexcept;
+
+private:
+    const unsigned char *m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+} // namespace appimagelauncher
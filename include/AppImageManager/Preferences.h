@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QString>
 #include <QtGlobal>
 
 namespace appimagelauncher {
@@ -20,9 +21,20 @@ struct Preferences {
     bool confirmRemoval = true;
     ViewMode viewMode = ViewMode::List;
     LanguageOption language = LanguageOption::System;
+    // AppImages that finish downloading into this directory are imported automatically;
+    // empty when no directory is watched.
+    QString inboxDirectory;
 
     static Preferences load();
     void save() const;
+
+    // Compares every field, so the settings dialog notices a change to any of them.
+    bool operator==(const Preferences &other) const
+    {
+        return moveToStorageOnAdd == other.moveToStorageOnAdd && confirmRemoval == other.confirmRemoval
+            && viewMode == other.viewMode && language == other.language && inboxDirectory == other.inboxDirectory;
+    }
+    bool operator!=(const Preferences &other) const { return !(*this == other); }
 };
 
 } // namespace appimagelauncher
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "AppImageManager/AppImageEntry.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace appimagelauncher {
+
+// In-memory filter over the managed library. Each entry's name, id and embedded
+// categories are lowercased once and indexed by trigram, so a query only verifies the
+// entries whose text contains every trigram of its terms. Every whitespace-separated
+// term must occur as a substring; case folding covers ASCII only.
+//
+// The index keeps the result of the current query and updates it as entries change.
+// Extending the query (typing further) narrows the previous result instead of searching
+// the whole library again.
+class SearchIndex {
+public:
+    void rebuild(const std::vector<AppImageEntry> &entries);
+    // Adds or replaces the entry with the same id.
+    void insert(const AppImageEntry &entry);
+    void erase(const std::string &id);
+
+    void setQuery(const std::string &query);
+    const std::string &query() const noexcept { return m_query; }
+    // Whether the entry matches the current query; everything matches an empty query.
+    bool matches(const std::string &id) const;
+    std::vector<std::string> matchingIds() const;
+
+private:
+    struct Document {
+        std::string id;
+        std::string text;
+        bool alive = true;
+    };
+
+    static std::string normalize(const std::string &value);
+    bool documentMatches(const Document &document) const;
+    std::vector<std::uint32_t> candidates() const;
+    void compact();
+
+private:
+    std::vector<Document> m_documents;
+    std::unordered_map<std::string, std::uint32_t> m_documentById;
+    // Posting lists of document indexes per packed trigram, in increasing order.
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> m_trigrams;
+    std::size_t m_deadDocuments = 0;
+
+    std::string m_query;
+    std::vector<std::string> m_terms;
+    std::vector<bool> m_matches;
+};
+
+} // namespace appimagelauncher
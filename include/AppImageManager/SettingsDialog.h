@@ -10,6 +10,9 @@ class QRadioButton;
 class QComboBox;
 class QDialogButtonBox;
 class QGroupBox;
+class QLabel;
+class QLineEdit;
+class QPushButton;
 QT_END_NAMESPACE
 
 namespace appimagelauncher {
@@ -28,11 +31,15 @@ private:
     void buildUi();
     void retranslateUi();
     void applyInitialState(const Preferences &preferences);
+    void onBrowseInbox();
 
 private:
     Preferences m_initialPreferences;
     QCheckBox *m_moveToStorageCheck;
     QCheckBox *m_confirmRemovalCheck;
+    QLabel *m_inboxLabel;
+    QLineEdit *m_inboxEdit;
+    QPushButton *m_inboxBrowseButton;
     QRadioButton *m_listViewRadio;
     QRadioButton *m_gridViewRadio;
     QComboBox *m_languageCombo;
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace appimagelauncher {
+
+// Incremental SHA-256 (FIPS 180-4). Uses the x86 SHA extensions when the CPU has them and
+// a portable implementation otherwise.
+class Sha256 {
+public:
+    using Digest = std::array<std::uint8_t, 32>;
+
+    Sha256();
+
+    void update(const void *data, std::size_t size);
+    Digest finish();
+
+    static Digest digest(const void *data, std::size_t size);
+    static std::string toHex(const Digest &digest);
+    // "sha-ni" or "portable", for diagnostics.
+    static const char *implementation();
+
+private:
+    void compress(const std::uint8_t *blocks, std::size_t count);
+
+private:
+    std::array<std::uint32_t, 8> m_state;
+    std::array<std::uint8_t, 64> m_buffer;
+    std::size_t m_buffered = 0;
+    std::uint64_t m_length = 0;
+};
+
+} // namespace appimagelauncher
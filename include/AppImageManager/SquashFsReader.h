@@ -0,0 +1,111 @@
+#pragma once
+
+#include "AppImageManager/MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace appimagelauncher {
+
+// Read-only access to the SquashFS payload of a type 2 AppImage without executing or
+// mounting it. The file is memory-mapped; the payload is located right after the ELF
+// runtime, and directory listings and files are decompressed on demand (gzip, xz and
+// lzma, plus zstd when built with libzstd).
+//
+// Structural problems (not an AppImage, corrupt tables, unsupported compression) throw
+// std::runtime_error; lookups of paths that do not exist return std::nullopt or an empty
+// listing. Instances cache decoded metadata and are not thread-safe.
+class SquashFsReader {
+public:
+    enum class EntryType {
+        Directory,
+        File,
+        Symlink,
+        Other
+    };
+
+    struct DirectoryEntry {
+        std::string name;
+        EntryType type;
+    };
+
+    explicit SquashFsReader(const std::filesystem::path &appImagePath);
+
+    // Size of the ELF runtime (end of its section header table), i.e. where the payload of
+    // a type 2 AppImage starts. std::nullopt when the data is not a well-formed ELF header.
+    static std::optional<std::uint64_t> elfPayloadOffset(const unsigned char *data, std::size_t size);
+    // The same from just the header: data holds the first size bytes of a fileSize-byte file.
+    static std::optional<std::uint64_t> elfPayloadOffset(const unsigned char *data, std::size_t size,
+                                                         std::uint64_t fileSize);
+
+    std::uint64_t payloadOffset() const noexcept { return m_payloadOffset; }
+    std::uint64_t payloadSize() const noexcept { return m_superblock.bytesUsed; }
+
+    std::vector<DirectoryEntry> listDirectory(const std::string &path) const;
+    // Follows symlinks, including .DirIcon-style links to files elsewhere in the image.
+    std::optional<std::string> readFile(const std::string &path) const;
+    std::optional<std::string> readLink(const std::string &path) const;
+
+private:
+    struct Superblock {
+        std::uint32_t inodeCount = 0;
+        std::uint32_t blockSize = 0;
+        std::uint32_t fragmentCount = 0;
+        std::uint16_t compression = 0;
+        std::uint16_t flags = 0;
+        std::uint64_t rootInode = 0;
+        std::uint64_t bytesUsed = 0;
+        std::uint64_t inodeTableStart = 0;
+        std::uint64_t directoryTableStart = 0;
+        std::uint64_t fragmentTableStart = 0;
+    };
+
+    struct MetadataCursor {
+        std::uint64_t block = 0;
+        std::size_t offset = 0;
+    };
+
+    struct Inode {
+        std::uint16_t type = 0;
+        std::uint32_t directoryBlock = 0;
+        std::uint16_t directoryOffset = 0;
+        std::uint32_t directorySize = 0;
+        std::uint64_t blocksStart = 0;
+        std::uint64_t fileSize = 0;
+        std::uint32_t fragment = 0;
+        std::uint32_t fragmentOffset = 0;
+        // The block size list is only walked while reading, so huge files cost nothing to stat.
+        MetadataCursor blockList;
+        std::uint64_t blockCount = 0;
+        std::string target;
+    };
+
+    struct MetadataBlock {
+        std::string data;
+        std::uint64_t storedSize = 0;
+    };
+
+    const unsigned char *at(std::uint64_t position, std::uint64_t length) const;
+    std::string decompress(const unsigned char *data, std::size_t size, std::size_t capacity) const;
+    const MetadataBlock &metadataBlock(std::uint64_t position) const;
+    void readMetadata(std::uint64_t tableStart, MetadataCursor &cursor, void *out, std::size_t length) const;
+    Inode readInode(std::uint64_t reference) const;
+    std::optional<Inode> lookup(const Inode &directory, const std::string &name) const;
+    std::vector<std::pair<DirectoryEntry, std::uint64_t>> readDirectory(const Inode &directory) const;
+    std::optional<Inode> resolve(const std::string &path, bool followFinalSymlink) const;
+    std::string readFragment(std::uint32_t index) const;
+
+private:
+    MappedFile m_file;
+    std::uint64_t m_payloadOffset = 0;
+    Superblock m_superblock;
+    mutable std::unordered_map<std::uint64_t, MetadataBlock> m_metadataCache;
+};
+
+} // namespace appimagelauncher
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "AppImageManager/AppImageEntry.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace appimagelauncher {
+
+enum class StorageIssueKind {
+    // A valid AppImage in storage that no entry points at, e.g. from an import that was
+    // interrupted before it was registered or a manual copy. Repaired by registering it.
+    UntrackedAppImage,
+    // A file in storage that is not an AppImage. Deleted.
+    InvalidFile,
+    // A hidden .part or .update file whose process is gone, or a .version or .dedupe file
+    // left by an interrupted swap. Deleted.
+    StaleTemporary,
+    // Kept versions of an entry that no longer exists. Deleted.
+    OrphanedVersions,
+    // An entry whose AppImage is gone. Restored from its active version when that is kept,
+    // otherwise the entry is removed.
+    MissingAppImage,
+    // An autostart file for an entry that is gone or has autostart off. Deleted.
+    StaleAutostart,
+    // An entry with autostart on but no autostart file. Rewritten.
+    MissingAutostart
+};
+
+struct StorageIssue {
+    StorageIssueKind kind = StorageIssueKind::UntrackedAppImage;
+    // The entry concerned, when there is one.
+    std::string id;
+    std::filesystem::path path;
+    // Freed by deleting path; 0 for files that are hardlinked elsewhere.
+    std::uint64_t bytes = 0;
+    std::string error;
+};
+
+struct StorageReport {
+    std::vector<StorageIssue> issues;
+    std::size_t filesScanned = 0;
+    // What repairing the issues deletes.
+    std::uint64_t reclaimableBytes = 0;
+    double seconds = 0.0;
+    bool cancelled = false;
+};
+
+// Called every few hundred files with the number scanned so far; returning false cancels.
+using StorageScanProgress = std::function<bool(std::size_t filesScanned)>;
+
+// Files this recent are left out of a scan: an import that has placed its file but not yet
+// registered it, or a swap in progress, is not an orphan.
+constexpr std::chrono::seconds kStorageGracePeriod { 600 };
+
+// Reconciles the storage directory (including the versions under its .versions directory)
+// and the autostart directory with the given entries in one pass over each directory, with
+// the entries looked up by name instead of each file being searched for. Only reads the
+// given entries, so it can run on any thread; AppImageManager::repairStorage() applies the
+// result. Throws std::runtime_error when the storage directory cannot be read.
+StorageReport scanStorage(const std::filesystem::path &storageDirectory, const std::filesystem::path &autostartDirectory,
+    const std::vector<AppImageEntry> &entries, const StorageScanProgress &progress = {},
+    std::chrono::seconds gracePeriod = kStorageGracePeriod);
+
+// Whether repairing an issue of this kind deletes its path, freeing StorageIssue::bytes.
+bool repairDeletes(StorageIssueKind kind);
+
+const char *storageIssueName(StorageIssueKind kind);
+
+} // namespace appimagelauncher
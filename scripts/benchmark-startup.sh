@@ -0,0 +1,41 @@
+#!/bin/sh
+# Measures wall time from main() to exit for the headless commands.
+#
+# Usage: scripts/benchmark-startup.sh [binary] [iterations]
+#
+# Runs against a throw-away XDG data/config/runtime home so the real library is never
+# touched, and bypasses any running daemon so the in-process path is what gets measured.
+set -eu
+
+binary=${1:-./build/appimagemanager}
+iterations=${2:-50}
+
+sandbox=$(mktemp -d)
+trap 'rm -rf "$sandbox"' EXIT INT TERM
+
+export XDG_DATA_HOME="$sandbox/data"
+export XDG_CONFIG_HOME="$sandbox/config"
+export XDG_RUNTIME_DIR="$sandbox/runtime"
+export APPIMAGEMANAGER_NO_DAEMON=1
+export APPIMAGEMANAGER_TIMING=1
+mkdir -p "$XDG_RUNTIME_DIR"
+
+for command in storage-dir manifest list help; do
+    i=0
+    while [ "$i" -lt "$iterations" ]; do
+        "$binary" "$command" 2>&1 >/dev/null | grep '^appimagemanager-timing' || true
+        i=$((i + 1))
+    done
+done | awk -F '\t' '
+    {
+        sub(/us$/, "", $3)
+        count[$2]++
+        total[$2] += $3
+        if (!($2 in best) || $3 < best[$2]) best[$2] = $3
+    }
+    END {
+        printf "%-14s %8s %12s %12s\n", "command", "runs", "mean (us)", "best (us)"
+        for (command in count) {
+            printf "%-14s %8d %12.0f %12d\n", command, count[command], total[command] / count[command], best[command]
+        }
+    }'
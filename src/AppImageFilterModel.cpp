@@ -0,0 +1,25 @@
+#include "AppImageManager/AppImageFilterModel.h"
+
+#include "AppImageManager/AppImageListModel.h"
+
+namespace appimagelauncher {
+
+AppImageFilterModel::AppImageFilterModel(AppImageListModel *source, QObject *parent)
+    : QSortFilterProxyModel(parent)
+    , m_source(source)
+{
+    setSourceModel(m_source);
+}
+
+void AppImageFilterModel::setQuery(const QString &query)
+{
+    m_source->setQuery(query);
+    invalidateFilter();
+}
+
+bool AppImageFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    return !sourceParent.isValid() && m_source->rowMatchesQuery(sourceRow);
+}
+
+} // namespace appimagelauncher
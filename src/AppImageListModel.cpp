@@ -0,0 +1,413 @@
+#include "AppImageManager/AppImageListModel.h"
+
+#include "AppImageManager/AppImageValidator.h"
+#include "AppImageManager/IconCache.h"
+
+#include <QColor>
+#include <QFont>
+#include <QLocale>
+#include <QPainter>
+#include <QPixmap>
+#include <QStringList>
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+namespace appimagelauncher {
+
+namespace {
+
+QString initialsForName(const QString &name)
+{
+    const QString trimmed = name.trimmed();
+    if (trimmed.isEmpty()) {
+        return QStringLiteral("A");
+    }
+
+    QString initials;
+    bool takeNext = true;
+    for (const QChar &ch : trimmed) {
+        if (ch.isSpace()) {
+            takeNext = true;
+            continue;
+        }
+        if (takeNext) {
+            initials.append(ch);
+            takeNext = false;
+            if (initials.size() >= 2) {
+                break;
+            }
+        }
+    }
+
+    if (initials.isEmpty()) {
+        initials = trimmed.left(2);
+    }
+
+    return initials.toUpper();
+}
+
+// Everything persisted; the normalised paths follow from the others.
+bool sameEntry(const AppImageEntry &lhs, const AppImageEntry &rhs)
+{
+    return lhs.id == rhs.id && lhs.name == rhs.name && lhs.storedPath == rhs.storedPath
+        && lhs.originalPath == rhs.originalPath && lhs.autostart == rhs.autostart && lhs.version == rhs.version
+        && lhs.categories == rhs.categories && lhs.comment == rhs.comment && lhs.iconName == rhs.iconName
+        && lhs.contentHash == rhs.contentHash && lhs.appImageType == rhs.appImageType && lhs.machine == rhs.machine
+        && lhs.payloadOffset == rhs.payloadOffset && lhs.activeVersion == rhs.activeVersion;
+}
+
+QColor accentColorForId(const std::string &id)
+{
+    const std::size_t hash = std::hash<std::string> {}(id);
+    const int hue = static_cast<int>(hash % 360);
+    QColor color;
+    color.setHsl(hue, 150, 140);
+    return color;
+}
+
+} // namespace
+
+AppImageListModel::AppImageListModel(AppImageManager &manager, IconCache *iconCache, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_manager(manager)
+    , m_iconCache(iconCache)
+    , m_viewMode(ViewMode::List)
+{
+    // Same ordering QString::localeAwareCompare gave, but decoded and collated once per
+    // name instead of once per comparison.
+    m_collator.setLocale(QLocale());
+    connect(m_iconCache, &IconCache::iconReady, this, &AppImageListModel::onIconReady);
+}
+
+int AppImageListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_rows.size());
+}
+
+QVariant AppImageListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= rowCount()) {
+        return QVariant();
+    }
+
+    const Row &row = m_rows[static_cast<std::size_t>(index.row())];
+    const AppImageEntry &entry = row.entry;
+    switch (role) {
+    case Qt::DisplayRole:
+        return decoratedName(row);
+    case Qt::DecorationRole: {
+        const QIcon icon = m_iconCache->icon(entry);
+        return icon.isNull() ? placeholderAvatar(entry) : icon;
+    }
+    case Qt::ToolTipRole:
+        return toolTip(row);
+    case Qt::TextAlignmentRole:
+        return m_viewMode == ViewMode::Grid ? int(Qt::AlignHCenter | Qt::AlignBottom) : int(Qt::AlignVCenter | Qt::AlignLeft);
+    case IdRole:
+        return QString::fromStdString(entry.id);
+    case AutostartRole:
+        return entry.autostart;
+    default:
+        return QVariant();
+    }
+}
+
+void AppImageListModel::reload()
+{
+    beginResetModel();
+    auto entries = m_manager.entries();
+    m_searchIndex.rebuild(entries);
+    m_rows.clear();
+    for (auto &entry : entries) {
+        m_rows.push_back(makeRow(std::move(entry)));
+    }
+    std::sort(m_rows.begin(), m_rows.end(), rowLess);
+    m_rowById.clear();
+    m_rowById.reserve(m_rows.size());
+    indexRows(0, rowCount() - 1);
+    endResetModel();
+}
+
+void AppImageListModel::entryAdded(const AppImageEntry &entry)
+{
+    if (rowForId(entry.id) >= 0) {
+        entryChanged(entry.id);
+        return;
+    }
+
+    m_searchIndex.insert(entry);
+    Row added = makeRow(entry);
+    const int row = static_cast<int>(std::upper_bound(m_rows.begin(), m_rows.end(), added, rowLess) - m_rows.begin());
+    beginInsertRows(QModelIndex(), row, row);
+    m_rows.insert(m_rows.begin() + row, std::move(added));
+    indexRows(row, rowCount() - 1);
+    endInsertRows();
+}
+
+void AppImageListModel::entryChanged(const std::string &id)
+{
+    const int row = rowForId(id);
+    auto entry = m_manager.entryById(id);
+    if (row < 0 || !entry.has_value()) {
+        if (entry.has_value()) {
+            entryAdded(*entry);
+        } else if (row >= 0) {
+            entryRemoved(id);
+        }
+        return;
+    }
+
+    m_searchIndex.insert(*entry);
+    auto &current = m_rows[static_cast<std::size_t>(row)];
+    if (current.entry.name == entry->name) {
+        // Autostart toggles and similar changes keep the sort key and the position.
+        current.entry = std::move(*entry);
+        updateFileState(current);
+        const QModelIndex changed = index(row);
+        emit dataChanged(changed, changed);
+        return;
+    }
+
+    // A rename may move the row; binary search the part of the list on the side it moves to.
+    current = makeRow(std::move(*entry));
+    const auto begin = m_rows.begin();
+    const auto position = begin + row;
+    int target = row;
+    if (row > 0 && rowLess(*position, *(position - 1))) {
+        target = static_cast<int>(std::upper_bound(begin, position, *position, rowLess) - begin);
+    } else if (row + 1 < rowCount() && rowLess(*(position + 1), *position)) {
+        target = static_cast<int>(std::lower_bound(position + 1, m_rows.end(), *position, rowLess) - begin) - 1;
+    }
+
+    if (target != row) {
+        // beginMoveRows takes the destination as an index in the list before the move.
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), target > row ? target + 1 : target);
+        if (target > row) {
+            std::rotate(position, position + 1, begin + target + 1);
+        } else {
+            std::rotate(begin + target, position, position + 1);
+        }
+        indexRows(std::min(row, target), std::max(row, target));
+        endMoveRows();
+    }
+
+    const QModelIndex changed = index(target);
+    emit dataChanged(changed, changed);
+}
+
+void AppImageListModel::entryRemoved(const std::string &id)
+{
+    const int row = rowForId(id);
+    if (row >= 0) {
+        removeEntryRow(row);
+    }
+}
+
+void AppImageListModel::syncWithManager()
+{
+    std::unordered_map<std::string, AppImageEntry> current;
+    for (auto &entry : m_manager.entries()) {
+        current.emplace(entry.id, std::move(entry));
+    }
+
+    // Backwards, so removing a row does not shift the rows still to be visited.
+    std::vector<std::string> changed;
+    for (int row = rowCount() - 1; row >= 0; --row) {
+        const Row &existing = m_rows[static_cast<std::size_t>(row)];
+        const auto it = current.find(existing.entry.id);
+        if (it == current.end()) {
+            removeEntryRow(row);
+            continue;
+        }
+        if (!sameEntry(existing.entry, it->second) || storedFileMissing(it->second) != existing.storedFileMissing
+            || autostartFileMissing(it->second) != existing.autostartFileMissing) {
+            changed.push_back(it->first);
+        }
+        current.erase(it);
+    }
+
+    for (const auto &id : changed) {
+        entryChanged(id);
+    }
+    for (const auto &pair : current) {
+        entryAdded(pair.second);
+    }
+}
+
+void AppImageListModel::setViewMode(ViewMode mode)
+{
+    if (m_viewMode == mode) {
+        return;
+    }
+    m_viewMode = mode;
+    emitRowsChanged({ Qt::DecorationRole, Qt::TextAlignmentRole });
+}
+
+void AppImageListModel::retranslate()
+{
+    emitRowsChanged({ Qt::DisplayRole, Qt::ToolTipRole });
+}
+
+QModelIndex AppImageListModel::indexForId(const QString &id) const
+{
+    const int row = rowForId(id.toStdString());
+    return row >= 0 ? index(row) : QModelIndex();
+}
+
+void AppImageListModel::setQuery(const QString &query)
+{
+    m_searchIndex.setQuery(query.toStdString());
+}
+
+bool AppImageListModel::rowMatchesQuery(int row) const
+{
+    return row >= 0 && row < rowCount() && m_searchIndex.matches(m_rows[static_cast<std::size_t>(row)].entry.id);
+}
+
+void AppImageListModel::onIconReady(const QString &id)
+{
+    const QModelIndex changed = indexForId(id);
+    if (changed.isValid()) {
+        emit dataChanged(changed, changed, { Qt::DecorationRole });
+    }
+}
+
+AppImageListModel::Row AppImageListModel::makeRow(AppImageEntry entry) const
+{
+    QCollatorSortKey key = m_collator.sortKey(QString::fromStdString(entry.name));
+    Row row { std::move(entry), std::move(key) };
+    updateFileState(row);
+    return row;
+}
+
+void AppImageListModel::updateFileState(Row &row) const
+{
+    row.storedFileMissing = storedFileMissing(row.entry);
+    row.autostartFileMissing = autostartFileMissing(row.entry);
+}
+
+bool AppImageListModel::storedFileMissing(const AppImageEntry &entry)
+{
+    std::error_code error;
+    return !std::filesystem::exists(entry.storedPath, error);
+}
+
+bool AppImageListModel::autostartFileMissing(const AppImageEntry &entry) const
+{
+    std::error_code error;
+    return entry.autostart && !std::filesystem::exists(m_manager.autostartDesktopPath(entry.id), error);
+}
+
+void AppImageListModel::removeEntryRow(int row)
+{
+    const std::string &id = m_rows[static_cast<std::size_t>(row)].entry.id;
+    m_searchIndex.erase(id);
+    m_rowById.erase(id);
+    beginRemoveRows(QModelIndex(), row, row);
+    m_rows.erase(m_rows.begin() + row);
+    indexRows(row, rowCount() - 1);
+    endRemoveRows();
+}
+
+bool AppImageListModel::rowLess(const Row &lhs, const Row &rhs)
+{
+    return lhs.sortKey.compare(rhs.sortKey) < 0;
+}
+
+int AppImageListModel::rowForId(const std::string &id) const
+{
+    const auto it = m_rowById.find(id);
+    return it != m_rowById.end() ? it->second : -1;
+}
+
+void AppImageListModel::indexRows(int first, int last)
+{
+    for (int row = first; row <= last; ++row) {
+        m_rowById[m_rows[static_cast<std::size_t>(row)].entry.id] = row;
+    }
+}
+
+void AppImageListModel::emitRowsChanged(const QVector<int> &roles)
+{
+    if (!m_rows.empty()) {
+        emit dataChanged(index(0), index(rowCount() - 1), roles);
+    }
+}
+
+QString AppImageListModel::decoratedName(const Row &row) const
+{
+    QString text = QString::fromStdString(row.entry.name);
+    if (row.entry.autostart) {
+        text += tr(" (Autostart)");
+    }
+    if (row.storedFileMissing) {
+        text += tr(" (Missing)");
+    }
+    return text;
+}
+
+QString AppImageListModel::toolTip(const Row &row) const
+{
+    const AppImageEntry &entry = row.entry;
+    QStringList lines;
+    if (!entry.comment.empty()) {
+        lines << QString::fromStdString(entry.comment);
+    }
+    if (!entry.version.empty()) {
+        lines << tr("Version %1").arg(QString::fromStdString(entry.version));
+    }
+    if (entry.appImageType != 0) {
+        lines << tr("Type %1 AppImage for %2")
+                     .arg(entry.appImageType)
+                     .arg(QString::fromStdString(machineName(entry.machine)));
+    }
+    lines << QString::fromStdString(entry.storedPath.string());
+    if (row.storedFileMissing) {
+        lines << tr("This file no longer exists.");
+    }
+    if (row.autostartFileMissing) {
+        lines << tr("Its autostart entry was removed outside AppImage Manager.");
+    }
+    return lines.join(QLatin1Char('\n'));
+}
+
+QIcon AppImageListModel::placeholderAvatar(const AppImageEntry &entry) const
+{
+    const int size = m_viewMode == ViewMode::Grid ? 128 : 64;
+    const QString key = QString::fromStdString(entry.id) + QLatin1Char('\x1f') + QString::fromStdString(entry.name)
+        + QLatin1Char('\x1f') + QString::number(size);
+    const auto cached = m_placeholderAvatars.constFind(key);
+    if (cached != m_placeholderAvatars.constEnd()) {
+        return cached.value();
+    }
+
+    const QString initials = initialsForName(QString::fromStdString(entry.name));
+    const QColor background = accentColorForId(entry.id);
+
+    QPixmap pixmap(size, size);
+    pixmap.fill(Qt::transparent);
+
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setBrush(background);
+    painter.setPen(Qt::NoPen);
+    painter.drawEllipse(pixmap.rect().adjusted(2, 2, -2, -2));
+
+    QFont font = painter.font();
+    font.setBold(true);
+    font.setPixelSize(size / 2);
+    painter.setFont(font);
+    painter.setPen(Qt::white);
+    painter.drawText(pixmap.rect(), Qt::AlignCenter, initials);
+    painter.end();
+
+    const QIcon avatar(pixmap);
+    m_placeholderAvatars.insert(key, avatar);
+    return avatar;
+}
+
+} // namespace appimagelauncher
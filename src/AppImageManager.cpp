@@ -1,13 +1,21 @@
 #include "AppImageManager/AppImageManager.h"
 
+#include "AppImageManager/AppImageMetadata.h"
+#include "AppImageManager/ContentHash.h"
+#include "AppImageManager/ImportEngine.h"
+
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
-#include <sstream>
 #include <stdexcept>
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 namespace appimagelauncher {
 
 namespace {
@@ -71,6 +79,41 @@ std::string splitStem(const std::filesystem::path &path)
     return stem;
 }
 
+std::string storageExtension(const std::filesystem::path &path)
+{
+    return path.has_extension() ? path.extension().string() : std::string();
+}
+
+// Splits "name-12" into "name" and 12. Returns false when there is no numeric suffix.
+bool splitNumericSuffix(const std::string &name, std::string &base, unsigned &suffix)
+{
+    const auto dash = name.rfind('-');
+    if (dash == std::string::npos || dash == 0 || dash + 1 == name.size() || name.size() - dash > 10
+        || name[dash + 1] == '0') {
+        return false;
+    }
+    unsigned value = 0;
+    for (auto i = dash + 1; i < name.size(); ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(name[i]))) {
+            return false;
+        }
+        value = value * 10 + static_cast<unsigned>(name[i] - '0');
+    }
+    base = name.substr(0, dash);
+    suffix = value;
+    return true;
+}
+
+std::string withSuffix(const std::string &base, unsigned suffix)
+{
+    return suffix == 0 ? base : base + "-" + std::to_string(suffix);
+}
+
+void raiseTo(unsigned &next, unsigned value)
+{
+    next = std::max(next, value);
+}
+
 std::string trim(std::string value)
 {
     auto isSpace = [](unsigned char ch) { return std::isspace(ch); };
@@ -83,8 +126,131 @@ std::string trim(std::string value)
     return value;
 }
 
+std::filesystem::path normalizePath(const std::filesystem::path &path)
+{
+    if (path.empty()) {
+        return {};
+    }
+    std::error_code error;
+    auto absolute = std::filesystem::absolute(path, error);
+    if (error) {
+        return {};
+    }
+    return absolute.lexically_normal();
+}
+
+void normalizeEntryPaths(AppImageEntry &entry)
+{
+    entry.normalizedStoredPath = normalizePath(entry.storedPath);
+    entry.normalizedOriginalPath = normalizePath(entry.originalPath);
+}
+
+void eraseIndexed(std::unordered_multimap<std::string, std::string> &index, const std::string &key, const std::string &id)
+{
+    auto range = index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == id) {
+            index.erase(it);
+            return;
+        }
+    }
+}
+
+// Replaces path with a hardlink to target, swapping it in with rename() so path never goes
+// missing. Returns the bytes freed by dropping path's previous inode, or nothing when the
+// files already share an inode, differ in size or cannot be linked.
+std::optional<std::uint64_t> replaceWithHardlink(const std::filesystem::path &target, const std::filesystem::path &path)
+{
+    struct stat targetInfo {};
+    struct stat pathInfo {};
+    if (::stat(target.c_str(), &targetInfo) != 0 || ::stat(path.c_str(), &pathInfo) != 0) {
+        return std::nullopt;
+    }
+    if (targetInfo.st_dev != pathInfo.st_dev || targetInfo.st_ino == pathInfo.st_ino
+        || targetInfo.st_size != pathInfo.st_size) {
+        return std::nullopt;
+    }
+
+    std::filesystem::path temporary = path;
+    temporary += ".dedupe";
+    ::unlink(temporary.c_str());
+    if (::link(target.c_str(), temporary.c_str()) != 0) {
+        return std::nullopt;
+    }
+    if (::rename(temporary.c_str(), path.c_str()) != 0) {
+        ::unlink(temporary.c_str());
+        return std::nullopt;
+    }
+    return pathInfo.st_nlink == 1 ? static_cast<std::uint64_t>(pathInfo.st_size) : 0;
+}
+
+void removeStoredFile(const std::filesystem::path &storedPath)
+{
+    try {
+        if (!storedPath.empty() && std::filesystem::exists(storedPath)) {
+            std::filesystem::remove_all(storedPath);
+        }
+    } catch (const std::filesystem::filesystem_error &) {
+        // Ignore removal errors.
+    }
+}
+
+std::string versionFileName(unsigned number, const std::string &contentHash)
+{
+    return std::to_string(number) + "-" + contentHash + ".AppImage";
+}
+
+// Number and content hash from a versionFileName(); nothing for other files.
+std::optional<std::pair<unsigned, std::string>> parseVersionFileName(const std::string &name)
+{
+    const std::string extension = ".AppImage";
+    const std::size_t dash = name.find('-');
+    if (dash == 0 || dash == std::string::npos || name.size() <= dash + 1 + extension.size()
+        || name.compare(name.size() - extension.size(), extension.size(), extension) != 0
+        || !std::all_of(name.begin(), name.begin() + dash, [](unsigned char ch) { return std::isdigit(ch); })) {
+        return std::nullopt;
+    }
+    try {
+        return std::make_pair(static_cast<unsigned>(std::stoul(name.substr(0, dash))),
+            name.substr(dash + 1, name.size() - extension.size() - dash - 1));
+    } catch (const std::logic_error &) {
+        return std::nullopt;
+    }
+}
+
+// Hardlinks from to a new name to, copying when they are on different filesystems.
+void linkOrCopy(const std::filesystem::path &from, const std::filesystem::path &to)
+{
+    if (::link(from.c_str(), to.c_str()) != 0) {
+        copyForImport(from, to);
+    }
+}
+
 } // namespace
 
+AppImageManager::Batch::Batch(AppImageManager &manager)
+    : m_manager(manager)
+{
+    m_manager.beginBatch();
+}
+
+AppImageManager::Batch::~Batch()
+{
+    if (!m_finished) {
+        try {
+            m_manager.rollbackBatch();
+        } catch (...) {
+            // Destructors must not throw; the library state is restored regardless.
+        }
+    }
+}
+
+void AppImageManager::Batch::commit()
+{
+    m_finished = true;
+    m_manager.commitBatch();
+}
+
 AppImageManager::AppImageManager()
     : AppImageManager(defaultBaseDirectory())
 {
@@ -93,7 +259,7 @@ AppImageManager::AppImageManager()
 AppImageManager::AppImageManager(std::filesystem::path baseDirectory)
     : m_baseDirectory(ensureBaseDirectory(std::move(baseDirectory)))
     , m_storageDirectory(m_baseDirectory / "apps")
-    , m_manifestPath(m_baseDirectory / "manifest.tsv")
+    , m_manifest(m_baseDirectory)
     , m_autostartDirectory(ensureAutostartDirectory(defaultAutostartDirectory()))
 {
     ensureStorageDirectory();
@@ -102,68 +268,71 @@ AppImageManager::AppImageManager(std::filesystem::path baseDirectory)
 
 void AppImageManager::load()
 {
-    m_entries.clear();
-    std::ifstream stream(m_manifestPath);
-    if (!stream.is_open()) {
-        return;
+    const ManifestStore::Lock lock(m_manifest);
+    m_loadedGeneration = m_manifest.generation();
+    m_entries = m_manifest.load();
+    for (auto &pair : m_entries) {
+        normalizeEntryPaths(pair.second);
     }
+    rebuildIndexes();
+}
 
-    std::string line;
-    while (std::getline(stream, line)) {
-        if (line.empty()) {
-            continue;
-        }
-        std::istringstream lineStream(line);
-        std::string id;
-        std::string name;
-        std::string storedPath;
-        std::string originalPath;
-        std::string autostartFlag;
+bool AppImageManager::reloadIfChanged()
+{
+    if (m_batch || m_manifest.generation() == m_loadedGeneration) {
+        return false;
+    }
+    load();
+    return true;
+}
 
-        if (!std::getline(lineStream, id, '\t')) {
-            continue;
-        }
-        if (!std::getline(lineStream, name, '\t')) {
-            continue;
-        }
-        if (!std::getline(lineStream, storedPath, '\t')) {
-            continue;
-        }
-        if (!std::getline(lineStream, originalPath, '\t')) {
-            originalPath.clear();
-        }
-        if (!std::getline(lineStream, autostartFlag, '\t')) {
-            autostartFlag.clear();
-        }
+void AppImageManager::save()
+{
+    const ManifestStore::Lock lock(m_manifest);
+    m_manifest.save(m_entries);
+    m_loadedGeneration = m_manifest.generation();
+}
 
-        const bool autostart = autostartFlag == "1" || autostartFlag == "true" || autostartFlag == "yes";
+// Taken at the start of every mutation outside a batch and held until it is persisted:
+// the mutation then applies to the latest manifest and no other process can write in
+// between. Inside a batch nothing is written until commitBatch(), which merges instead.
+ManifestStore::Lock AppImageManager::lockForUpdate()
+{
+    if (m_batch) {
+        return {};
+    }
+    ManifestStore::Lock lock(m_manifest);
+    if (m_manifest.generation() != m_loadedGeneration) {
+        load();
+    }
+    return lock;
+}
 
-        AppImageEntry entry{
-            id,
-            name,
-            std::filesystem::path(storedPath),
-            std::filesystem::path(originalPath),
-            autostart
-        };
-        m_entries.emplace(entry.id, std::move(entry));
+void AppImageManager::persistEntry(const AppImageEntry &entry)
+{
+    if (m_manifest.recordPut(entry)) {
+        save();
     }
+    m_loadedGeneration = m_manifest.generation();
 }
 
-void AppImageManager::save() const
+void AppImageManager::persistRemoval(const std::string &id)
 {
-    std::ofstream stream(m_manifestPath, std::ios::trunc);
-    if (!stream.is_open()) {
-        throw std::runtime_error("Unable to write AppImage manifest: " + m_manifestPath.string());
+    if (m_manifest.recordErase(id)) {
+        save();
     }
+    m_loadedGeneration = m_manifest.generation();
+}
 
-    for (const auto &pair : m_entries) {
-        const auto &entry = pair.second;
-        stream << entry.id << '\t'
-               << entry.name << '\t'
-               << entry.storedPath.string() << '\t'
-               << entry.originalPath.string() << '\t'
-               << (entry.autostart ? "1" : "0") << '\n';
+void AppImageManager::persistChanges(const std::set<std::string> &ids)
+{
+    if (ids.empty()) {
+        return;
     }
+    if (m_manifest.recordChanges(m_entries, ids)) {
+        save();
+    }
+    m_loadedGeneration = m_manifest.generation();
 }
 
 const std::filesystem::path &AppImageManager::baseDirectory() const noexcept
@@ -197,109 +366,665 @@ std::optional<AppImageEntry> AppImageManager::entryById(const std::string &id) c
 
 std::optional<AppImageEntry> AppImageManager::entryByStoredPath(const std::filesystem::path &path) const
 {
-    try {
-        const auto normalizedInput = std::filesystem::absolute(path);
-        for (const auto &pair : m_entries) {
-            const auto normalizedStored = std::filesystem::absolute(pair.second.storedPath);
-            if (normalizedStored == normalizedInput) {
-                return pair.second;
-            }
-        }
-    } catch (const std::filesystem::filesystem_error &) {
-        return std::nullopt;
-    }
-    return std::nullopt;
+    return lookupIndexed(m_storedPathIndex, path);
 }
 
 std::optional<AppImageEntry> AppImageManager::entryByOriginalPath(const std::filesystem::path &path) const
 {
-    try {
-        const auto normalizedInput = std::filesystem::absolute(path);
-        for (const auto &pair : m_entries) {
-            if (pair.second.originalPath.empty()) {
-                continue;
-            }
-            const auto normalizedOriginal = std::filesystem::absolute(pair.second.originalPath);
-            if (normalizedOriginal == normalizedInput) {
-                return pair.second;
-            }
+    return lookupIndexed(m_originalPathIndex, path);
+}
+
+std::optional<AppImageEntry> AppImageManager::lookupIndexed(const std::unordered_multimap<std::string, std::string> &index,
+    const std::filesystem::path &path) const
+{
+    const auto normalizedInput = normalizePath(path);
+    if (normalizedInput.empty()) {
+        return std::nullopt;
+    }
+
+    // Prefer the lowest id when several entries share a path, matching manifest order.
+    const auto range = index.equal_range(normalizedInput.native());
+    const std::string *id = nullptr;
+    for (auto it = range.first; it != range.second; ++it) {
+        if (!id || it->second < *id) {
+            id = &it->second;
         }
-    } catch (const std::filesystem::filesystem_error &) {
+    }
+    if (!id) {
         return std::nullopt;
     }
-    return std::nullopt;
+    return m_entries.at(*id);
+}
+
+void AppImageManager::rebuildIndexes()
+{
+    m_storedPathIndex.clear();
+    m_originalPathIndex.clear();
+    m_contentHashIndex.clear();
+    m_nextIdSuffix.clear();
+    m_storedPathIndex.reserve(m_entries.size());
+    m_originalPathIndex.reserve(m_entries.size());
+    m_contentHashIndex.reserve(m_entries.size());
+    for (const auto &pair : m_entries) {
+        indexEntry(pair.second);
+    }
+}
+
+void AppImageManager::indexEntry(const AppImageEntry &entry)
+{
+    if (!entry.normalizedStoredPath.empty()) {
+        m_storedPathIndex.emplace(entry.normalizedStoredPath.native(), entry.id);
+    }
+    if (!entry.normalizedOriginalPath.empty()) {
+        m_originalPathIndex.emplace(entry.normalizedOriginalPath.native(), entry.id);
+    }
+    if (!entry.contentHash.empty()) {
+        m_contentHashIndex.emplace(entry.contentHash, entry.id);
+    }
+    raiseTo(m_nextIdSuffix[entry.id], 1);
+    std::string base;
+    unsigned suffix = 0;
+    if (splitNumericSuffix(entry.id, base, suffix)) {
+        raiseTo(m_nextIdSuffix[base], suffix + 1);
+    }
+}
+
+void AppImageManager::unindexEntry(const AppImageEntry &entry)
+{
+    eraseIndexed(m_storedPathIndex, entry.normalizedStoredPath.native(), entry.id);
+    eraseIndexed(m_originalPathIndex, entry.normalizedOriginalPath.native(), entry.id);
+    eraseIndexed(m_contentHashIndex, entry.contentHash, entry.id);
+}
+
+AppImageEntry AppImageManager::addAppImage(
+    const std::filesystem::path &path, bool moveToStorage, const ImportProgress &progress)
+{
+    PreparedImport import = prepareImport(path, moveToStorage);
+    performImport(import, progress);
+    return finishImport(import);
 }
 
-AppImageEntry AppImageManager::addAppImage(const std::filesystem::path &path, bool moveToStorage)
+AppImageManager::PreparedImport AppImageManager::prepareImport(const std::filesystem::path &path, bool moveToStorage)
 {
     if (!std::filesystem::exists(path)) {
         throw std::runtime_error("AppImage does not exist: " + path.string());
     }
 
-    std::filesystem::path absolutePath = std::filesystem::absolute(path);
-    std::filesystem::path destination = m_storageDirectory / path.filename();
+    PreparedImport import;
+    // Rejects junk before anything is moved or hashed.
+    import.format = validateAppImage(path);
+    import.source = path;
+    import.absoluteSource = std::filesystem::absolute(path);
+    import.moveToStorage = moveToStorage;
+    if (!moveToStorage) {
+        import.storedPath = import.absoluteSource;
+        return import;
+    }
+
+    scanStorageNames();
+    import.storageStem = splitStem(path);
+    import.storageExtension = storageExtension(path);
+    unsigned &next = m_nextStorageSuffix[{ import.storageStem, import.storageExtension }];
+    // Taken right away so imports queued behind this one get different names.
+    import.storageSuffix = next++;
+    import.storedPath
+        = m_storageDirectory / (withSuffix(import.storageStem, import.storageSuffix) + import.storageExtension);
+    return import;
+}
 
-    std::string stem = splitStem(path);
-    std::string extension = path.has_extension() ? path.extension().string() : std::string();
-    int suffix = 1;
-    while (std::filesystem::exists(destination)) {
-        destination = m_storageDirectory / (stem + "-" + std::to_string(suffix++) + extension);
+void AppImageManager::performImport(PreparedImport &import, const ImportProgress &progress)
+{
+    if (import.moveToStorage) {
+        // The name from prepareImport() is normally free; should another process have taken
+        // it, the following suffixes are tried instead of replacing its file.
+        const std::filesystem::path directory = import.storedPath.parent_path();
+        const unsigned first = import.storageSuffix;
+        unsigned placed = first;
+        const auto candidates = [&](unsigned attempt) {
+            placed = first + attempt;
+            return directory / (withSuffix(import.storageStem, placed) + import.storageExtension);
+        };
+        import.storedPath = moveForImport(import.source, candidates, progress).destination;
+        import.storageSuffix = placed;
     }
+    import.metadata = readAppImageMetadata(import.storedPath);
+    import.contentHash = contentHashOfFile(import.storedPath);
+}
 
-    std::filesystem::path storedPath = destination;
-    if (moveToStorage) {
-        try {
-            std::filesystem::rename(path, destination);
-        } catch (const std::filesystem::filesystem_error &) {
-            std::filesystem::copy_file(path, destination, std::filesystem::copy_options::overwrite_existing);
-            std::filesystem::remove(path);
-        }
-    } else {
-        storedPath = absolutePath;
+AppImageEntry AppImageManager::finishImport(const PreparedImport &import)
+{
+    const auto lock = lockForUpdate();
+    if (import.moveToStorage) {
+        noteStorageName(import.storageStem, import.storageExtension, import.storageSuffix);
     }
 
+    const std::filesystem::path &storedPath = import.storedPath;
     std::string id = generateId(storedPath);
 
-    std::string displayName = trim(splitStem(storedPath));
+    std::string displayName = trim(import.metadata.name);
+    if (displayName.empty()) {
+        displayName = trim(splitStem(storedPath));
+    }
     if (displayName.empty()) {
         displayName = storedPath.filename().string();
     }
 
-    AppImageEntry entry{
-        id,
-        displayName,
-        storedPath,
-        moveToStorage ? absolutePath : std::filesystem::path{},
-        false
-    };
+    AppImageEntry entry;
+    entry.id = id;
+    entry.name = displayName;
+    entry.storedPath = storedPath;
+    entry.originalPath = import.moveToStorage ? import.absoluteSource : std::filesystem::path{};
+    entry.version = import.metadata.version;
+    entry.categories = import.metadata.categories;
+    entry.comment = import.metadata.comment;
+    entry.iconName = import.metadata.icon;
+    entry.contentHash = import.contentHash;
+    entry.appImageType = import.format.type;
+    entry.machine = import.format.machine;
+    entry.payloadOffset = import.format.payloadOffset;
+    normalizeEntryPaths(entry);
+    // A re-download of an AppImage already in storage shares its inode instead of taking
+    // the space twice, as does an untracked copy in storage registered by repairStorage().
+    if (isInStorage(entry)) {
+        if (const AppImageEntry *holder = sharedStoredFileFor(entry)) {
+            replaceWithHardlink(holder->storedPath, storedPath);
+        }
+    }
     m_entries[entry.id] = entry;
-    save();
+    indexEntry(entry);
+    if (m_batch) {
+        m_batch->changedIds.insert(entry.id);
+        if (import.moveToStorage) {
+            m_batch->importedFiles.emplace_back(storedPath, import.source);
+        }
+        return entry;
+    }
+    persistEntry(entry);
     return entry;
 }
 
+std::vector<AppImageEntry> AppImageManager::duplicatesOf(const std::string &id) const
+{
+    std::vector<AppImageEntry> duplicates;
+    const auto it = m_entries.find(id);
+    if (it == m_entries.end() || it->second.contentHash.empty()) {
+        return duplicates;
+    }
+    const auto range = m_contentHashIndex.equal_range(it->second.contentHash);
+    for (auto match = range.first; match != range.second; ++match) {
+        if (match->second != id) {
+            duplicates.push_back(m_entries.at(match->second));
+        }
+    }
+    std::sort(duplicates.begin(), duplicates.end(), [](const auto &lhs, const auto &rhs) { return lhs.id < rhs.id; });
+    return duplicates;
+}
+
+AppImageManager::DedupeResult AppImageManager::dedupe()
+{
+    DedupeResult result;
+    // Hashing a large library takes a while, so it happens before taking the manifest
+    // lock; the hashes are then only applied to entries that still point at the same file.
+    std::vector<std::pair<AppImageEntry, std::string>> hashed;
+    for (const auto &pair : m_entries) {
+        const AppImageEntry &entry = pair.second;
+        if (entry.contentHash.empty() && std::filesystem::exists(entry.storedPath)) {
+            hashed.emplace_back(entry, contentHashOfFile(entry.storedPath));
+        }
+    }
+
+    const auto lock = lockForUpdate();
+    std::set<std::string> changedIds;
+    for (const auto &pair : hashed) {
+        const auto it = m_entries.find(pair.first.id);
+        if (it == m_entries.end() || !it->second.contentHash.empty() || it->second.storedPath != pair.first.storedPath) {
+            continue;
+        }
+        unindexEntry(it->second);
+        it->second.contentHash = pair.second;
+        indexEntry(it->second);
+        changedIds.insert(it->first);
+    }
+    result.hashed = changedIds.size();
+    if (m_batch) {
+        m_batch->changedIds.insert(changedIds.begin(), changedIds.end());
+    } else {
+        persistChanges(changedIds);
+    }
+
+    for (const auto &pair : m_entries) {
+        const AppImageEntry &entry = pair.second;
+        if (entry.contentHash.empty() || !isInStorage(entry)) {
+            continue;
+        }
+        // The lowest id of each group keeps its inode and the rest are linked to it.
+        const AppImageEntry *holder = sharedStoredFileFor(entry);
+        if (!holder || holder->id > entry.id) {
+            continue;
+        }
+        if (const auto reclaimed = replaceWithHardlink(holder->storedPath, entry.storedPath)) {
+            ++result.linked;
+            result.reclaimedBytes += *reclaimed;
+        }
+    }
+    return result;
+}
+
+DeltaUpdateResult AppImageManager::updateAppImage(const std::string &id, const std::string &source)
+{
+    if (m_batch) {
+        throw std::runtime_error("AppImages cannot be updated inside a batch");
+    }
+    const auto current = entryById(id);
+    if (!current) {
+        throw std::runtime_error("Unknown AppImage id: " + id);
+    }
+
+    // Like dedupe(), the slow part happens before taking the manifest lock, into a hidden
+    // file beside the stored one so the swap is a rename within one directory.
+    const std::filesystem::path &storedPath = current->storedPath;
+    const std::filesystem::path temporary
+        = storedPath.parent_path() / ("." + storedPath.filename().string() + "." + std::to_string(::getpid()) + ".update");
+    DeltaUpdateResult result
+        = buildDeltaUpdate(storedPath, readUpdateInformation(storedPath).value_or(std::string()), source, temporary);
+    if (result.upToDate) {
+        return result;
+    }
+
+    std::string contentHash;
+    try {
+        validateAppImage(temporary);
+        contentHash = contentHashOfFile(temporary);
+    } catch (...) {
+        ::unlink(temporary.c_str());
+        throw;
+    }
+
+    const auto lock = lockForUpdate();
+    const auto it = m_entries.find(id);
+    if (it == m_entries.end() || it->second.storedPath != storedPath) {
+        ::unlink(temporary.c_str());
+        throw std::runtime_error("AppImage " + id + " changed while it was being updated");
+    }
+    AppImageEntry &entry = it->second;
+    if (entry.contentHash == contentHash) {
+        ::unlink(temporary.c_str());
+        result.upToDate = true;
+        return result;
+    }
+    bool kept = false;
+    try {
+        result.upToDate = retainActiveVersion(entry).contentHash == contentHash;
+        kept = activateKeptVersion(entry, contentHash);
+    } catch (...) {
+        ::unlink(temporary.c_str());
+        throw;
+    }
+    if (kept) {
+        ::unlink(temporary.c_str());
+    } else {
+        switchToVersion(entry, storeVersion(id, temporary, contentHash, {}));
+        pruneVersions(entry, kRetainedVersions);
+    }
+    persistEntry(entry);
+    return result;
+}
+
+std::filesystem::path AppImageManager::versionsDirectory(const std::string &id) const
+{
+    return m_storageDirectory / ".versions" / id;
+}
+
+std::vector<AppImageManager::Version> AppImageManager::versions(const std::string &id) const
+{
+    const auto it = m_entries.find(id);
+    if (it == m_entries.end()) {
+        throw std::runtime_error("Unknown AppImage id: " + id);
+    }
+    std::vector<Version> found;
+    std::error_code error;
+    for (const auto &file : std::filesystem::directory_iterator(versionsDirectory(id), error)) {
+        const auto parsed = parseVersionFileName(file.path().filename().string());
+        if (parsed && file.is_regular_file()) {
+            found.push_back({ parsed->first, file.path(), parsed->second, parsed->first == it->second.activeVersion });
+        }
+    }
+    std::sort(found.begin(), found.end(), [](const Version &lhs, const Version &rhs) { return lhs.number < rhs.number; });
+    return found;
+}
+
+AppImageEntry AppImageManager::addVersion(const std::string &id, const std::filesystem::path &path, const ImportProgress &progress)
+{
+    if (m_batch) {
+        throw std::runtime_error("AppImage versions cannot be changed inside a batch");
+    }
+    if (!entryById(id)) {
+        throw std::runtime_error("Unknown AppImage id: " + id);
+    }
+    // Checked and hashed before taking the manifest lock, like dedupe().
+    validateAppImage(path);
+    const std::string contentHash = contentHashOfFile(path);
+
+    const auto lock = lockForUpdate();
+    AppImageEntry &entry = entryForVersionChange(id);
+    if (entry.contentHash == contentHash) {
+        return entry;
+    }
+    const Version previous = retainActiveVersion(entry);
+    if (activateKeptVersion(entry, contentHash)) {
+        persistEntry(entry);
+        return entry;
+    }
+    const Version added = storeVersion(id, path, contentHash, progress);
+    try {
+        shareIdenticalBlocks(previous.path, added.path);
+    } catch (const std::exception &) {
+        // Only saves space; the new version is complete either way.
+    }
+    switchToVersion(entry, added);
+    pruneVersions(entry, kRetainedVersions);
+    persistEntry(entry);
+    return entry;
+}
+
+AppImageEntry AppImageManager::activateVersion(const std::string &id, unsigned number)
+{
+    const auto lock = lockForUpdate();
+    AppImageEntry &entry = entryForVersionChange(id);
+    if (entry.activeVersion == number) {
+        return entry;
+    }
+    const auto all = versions(id);
+    const auto version
+        = std::find_if(all.begin(), all.end(), [number](const Version &candidate) { return candidate.number == number; });
+    if (version == all.end()) {
+        throw std::runtime_error("AppImage " + id + " has no version " + std::to_string(number));
+    }
+    retainActiveVersion(entry);
+    switchToVersion(entry, *version);
+    persistEntry(entry);
+    return entry;
+}
+
+AppImageEntry AppImageManager::rollback(const std::string &id)
+{
+    // The lock nests, so activateVersion() below applies to what was looked at here.
+    const auto lock = lockForUpdate();
+    const AppImageEntry &entry = entryForVersionChange(id);
+    unsigned target = 0;
+    for (const auto &version : versions(id)) {
+        if (version.number < entry.activeVersion) {
+            target = version.number;
+        }
+    }
+    if (target == 0) {
+        throw std::runtime_error("AppImage " + id + " has no earlier version to roll back to");
+    }
+    return activateVersion(id, target);
+}
+
+std::size_t AppImageManager::pruneVersions(const std::string &id, std::size_t keep)
+{
+    const auto lock = lockForUpdate();
+    return pruneVersions(entryForVersionChange(id), keep);
+}
+
+AppImageEntry &AppImageManager::entryForVersionChange(const std::string &id)
+{
+    if (m_batch) {
+        throw std::runtime_error("AppImage versions cannot be changed inside a batch");
+    }
+    const auto it = m_entries.find(id);
+    if (it == m_entries.end()) {
+        throw std::runtime_error("Unknown AppImage id: " + id);
+    }
+    return it->second;
+}
+
+// Keeps the file storedPath currently holds as a version, unless it already is one. Sets
+// activeVersion but leaves persisting to the caller.
+AppImageManager::Version AppImageManager::retainActiveVersion(AppImageEntry &entry)
+{
+    for (const auto &version : versions(entry.id)) {
+        if (version.active) {
+            return version;
+        }
+    }
+    const std::string contentHash = entry.contentHash.empty() ? contentHashOfFile(entry.storedPath) : entry.contentHash;
+    Version version = storeVersion(entry.id, {}, contentHash, {});
+    linkOrCopy(entry.storedPath, version.path);
+    entry.activeVersion = version.number;
+    version.active = true;
+    return version;
+}
+
+// Activates the kept version with this content hash, if there is one, so an identical build
+// is not stored twice. Leaves persisting to the caller.
+bool AppImageManager::activateKeptVersion(AppImageEntry &entry, const std::string &contentHash)
+{
+    for (const auto &version : versions(entry.id)) {
+        if (version.contentHash == contentHash) {
+            if (!version.active) {
+                switchToVersion(entry, version);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// Picks the next version number and, when source is given, moves it there.
+AppImageManager::Version AppImageManager::storeVersion(const std::string &id, const std::filesystem::path &source,
+    const std::string &contentHash, const ImportProgress &progress)
+{
+    const std::filesystem::path directory = versionsDirectory(id);
+    std::filesystem::create_directories(directory);
+    const auto existing = versions(id);
+    Version version;
+    version.number = existing.empty() ? 1 : existing.back().number + 1;
+    version.contentHash = contentHash;
+    version.path = directory / versionFileName(version.number, contentHash);
+    if (!source.empty()) {
+        version.path = moveForImport(source, version.path, progress).destination;
+    }
+    return version;
+}
+
+// Swaps the version in as storedPath and refreshes what the entry records about the file.
+void AppImageManager::switchToVersion(AppImageEntry &entry, const Version &version)
+{
+    std::filesystem::path temporary = entry.storedPath;
+    temporary += ".version";
+    ::unlink(temporary.c_str());
+    linkOrCopy(version.path, temporary);
+    if (::rename(temporary.c_str(), entry.storedPath.c_str()) != 0) {
+        const int error = errno;
+        ::unlink(temporary.c_str());
+        throw std::runtime_error("Unable to replace " + entry.storedPath.string() + ": " + std::strerror(error));
+    }
+
+    const AppImageMetadata metadata = readAppImageMetadata(entry.storedPath);
+    AppImageFormat format;
+    try {
+        format = validateAppImage(entry.storedPath);
+    } catch (const std::exception &) {
+        // Versions were validated when they were added; an old one may predate validation.
+    }
+    unindexEntry(entry);
+    entry.version = metadata.version;
+    entry.categories = metadata.categories;
+    entry.comment = metadata.comment;
+    entry.iconName = metadata.icon;
+    entry.contentHash = version.contentHash;
+    entry.appImageType = format.type;
+    entry.machine = format.machine;
+    entry.payloadOffset = format.payloadOffset;
+    entry.activeVersion = version.number;
+    indexEntry(entry);
+}
+
+std::size_t AppImageManager::pruneVersions(AppImageEntry &entry, std::size_t keep)
+{
+    auto all = versions(entry.id);
+    std::size_t removed = 0;
+    for (auto version = all.begin(); version != all.end() && all.size() - removed > std::max<std::size_t>(keep, 1); ++version) {
+        if (!version->active) {
+            removeStoredFile(version->path);
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+StorageReport AppImageManager::checkStorage(const StorageScanProgress &progress) const
+{
+    return scanStorage(m_storageDirectory, m_autostartDirectory, entries(), progress);
+}
+
+AppImageManager::RepairResult AppImageManager::repairStorage(const StorageReport &report)
+{
+    if (m_batch) {
+        throw std::runtime_error("Storage cannot be repaired inside a batch");
+    }
+    RepairResult result;
+    // Held across the batch, which nests its own lock, so nothing changes between checking
+    // an issue and repairing it.
+    const ManifestStore::Lock lock(m_manifest);
+    if (m_manifest.generation() != m_loadedGeneration) {
+        load();
+    }
+    Batch batch(*this);
+    for (const auto &issue : report.issues) {
+        if (repairIssue(issue)) {
+            ++result.repaired;
+            result.reclaimedBytes += repairDeletes(issue.kind) ? issue.bytes : 0;
+        } else {
+            ++result.skipped;
+        }
+    }
+    batch.commit();
+    return result;
+}
+
+// Files are deleted and autostart entries synced when the batch commits.
+bool AppImageManager::repairIssue(const StorageIssue &issue)
+{
+    std::error_code error;
+    const auto entry = m_entries.find(issue.id);
+    switch (issue.kind) {
+    case StorageIssueKind::UntrackedAppImage:
+        if (!std::filesystem::exists(issue.path, error) || entryByStoredPath(issue.path)) {
+            return false;
+        }
+        try {
+            addAppImage(issue.path, false);
+        } catch (const std::exception &) {
+            // No longer a valid AppImage; the next check reports it as such.
+            return false;
+        }
+        return true;
+    case StorageIssueKind::InvalidFile:
+    case StorageIssueKind::StaleTemporary:
+        if (!std::filesystem::exists(issue.path, error) || entryByStoredPath(issue.path)) {
+            return false;
+        }
+        m_batch->removedFiles.push_back(issue.path);
+        return true;
+    case StorageIssueKind::OrphanedVersions:
+        if (entry != m_entries.end() || normalizePath(issue.path) != normalizePath(versionsDirectory(issue.id))) {
+            return false;
+        }
+        m_batch->removedFiles.push_back(issue.path);
+        return true;
+    case StorageIssueKind::MissingAppImage: {
+        if (entry == m_entries.end() || std::filesystem::exists(entry->second.storedPath, error)) {
+            return false;
+        }
+        for (const auto &version : versions(issue.id)) {
+            if (version.active) {
+                try {
+                    linkOrCopy(version.path, entry->second.storedPath);
+                    return true;
+                } catch (const std::exception &) {
+                    return false;
+                }
+            }
+        }
+        removeAppImage(issue.id);
+        return true;
+    }
+    case StorageIssueKind::StaleAutostart:
+        if (entry != m_entries.end() && entry->second.autostart) {
+            return false;
+        }
+        m_batch->autostartIds.insert(issue.id);
+        return true;
+    case StorageIssueKind::MissingAutostart:
+        if (entry == m_entries.end() || !entry->second.autostart) {
+            return false;
+        }
+        m_batch->autostartIds.insert(issue.id);
+        return true;
+    }
+    return false;
+}
+
+bool AppImageManager::isInStorage(const AppImageEntry &entry) const
+{
+    return !entry.normalizedStoredPath.empty()
+        && entry.normalizedStoredPath.parent_path() == normalizePath(m_storageDirectory);
+}
+
+// The entry with the lowest id, other than this one, whose stored file has the same
+// content and lives in storage; AppImages registered in place are never linked to.
+const AppImageEntry *AppImageManager::sharedStoredFileFor(const AppImageEntry &entry) const
+{
+    if (entry.contentHash.empty()) {
+        return nullptr;
+    }
+    const AppImageEntry *holder = nullptr;
+    const auto range = m_contentHashIndex.equal_range(entry.contentHash);
+    for (auto match = range.first; match != range.second; ++match) {
+        if (match->second == entry.id || (holder && holder->id < match->second)) {
+            continue;
+        }
+        const auto other = m_entries.find(match->second);
+        if (other != m_entries.end() && isInStorage(other->second) && std::filesystem::exists(other->second.storedPath)) {
+            holder = &other->second;
+        }
+    }
+    return holder;
+}
+
 void AppImageManager::removeAppImage(const std::string &id)
 {
+    const auto lock = lockForUpdate();
     auto it = m_entries.find(id);
     if (it == m_entries.end()) {
         throw std::runtime_error("Unknown AppImage id: " + id);
     }
 
     const auto storedPath = it->second.storedPath;
+    unindexEntry(it->second);
+    if (m_batch) {
+        m_entries.erase(it);
+        m_batch->changedIds.insert(id);
+        m_batch->autostartIds.insert(id);
+        m_batch->removedFiles.push_back(storedPath);
+        m_batch->removedFiles.push_back(versionsDirectory(id));
+        return;
+    }
+
     removeAutostartEntry(id);
     m_entries.erase(it);
-    save();
-
-    try {
-        if (!storedPath.empty() && std::filesystem::exists(storedPath)) {
-            std::filesystem::remove(storedPath);
-        }
-    } catch (const std::filesystem::filesystem_error &) {
-        // Ignore removal errors.
-    }
+    persistRemoval(id);
+    removeStoredFile(storedPath);
+    removeStoredFile(versionsDirectory(id));
 }
 
 void AppImageManager::renameAppImage(const std::string &id, const std::string &displayName)
 {
+    const auto lock = lockForUpdate();
     auto it = m_entries.find(id);
     if (it == m_entries.end()) {
         throw std::runtime_error("Unknown AppImage id: " + id);
@@ -316,11 +1041,18 @@ void AppImageManager::renameAppImage(const std::string &id, const std::string &d
 
     const std::string previousName = it->second.name;
     it->second.name = trimmedName;
+    if (m_batch) {
+        m_batch->changedIds.insert(id);
+        if (it->second.autostart) {
+            m_batch->autostartIds.insert(id);
+        }
+        return;
+    }
     try {
         if (it->second.autostart) {
             writeAutostartEntry(it->second);
         }
-        save();
+        persistEntry(it->second);
     } catch (...) {
         it->second.name = previousName;
         throw;
@@ -329,7 +1061,24 @@ void AppImageManager::renameAppImage(const std::string &id, const std::string &d
 
 std::filesystem::path AppImageManager::manifestPath() const
 {
-    return m_manifestPath;
+    return m_manifest.path();
+}
+
+std::filesystem::path AppImageManager::manifestLockPath() const
+{
+    return m_manifest.lockPath();
+}
+
+std::filesystem::path AppImageManager::launchHistoryPath() const
+{
+    return m_baseDirectory / "launches.log";
+}
+
+std::filesystem::path AppImageManager::exportManifest(const std::filesystem::path &path) const
+{
+    const auto target = path.empty() ? m_manifest.legacyPath() : path;
+    ManifestStore::writeTsv(target, m_entries);
+    return target;
 }
 
 std::filesystem::path AppImageManager::ensureBaseDirectory(std::filesystem::path baseDirectory)
@@ -354,17 +1103,44 @@ std::filesystem::path AppImageManager::ensureAutostartDirectory(std::filesystem:
     return directory;
 }
 
-std::string AppImageManager::generateId(const std::filesystem::path &path) const
+std::string AppImageManager::generateId(const std::filesystem::path &path)
 {
-    std::string idBase = sanitizeId(splitStem(path));
-    std::string id = idBase;
-    int suffix = 1;
+    const std::string idBase = sanitizeId(splitStem(path));
+    unsigned &next = m_nextIdSuffix[idBase];
+    std::string id = withSuffix(idBase, next++);
+    // indexEntry() counts every existing id, so this loop normally does not run at all.
     while (m_entries.find(id) != m_entries.end()) {
-        id = idBase + "-" + std::to_string(suffix++);
+        id = withSuffix(idBase, next++);
     }
     return id;
 }
 
+void AppImageManager::scanStorageNames()
+{
+    if (m_storageNamesScanned) {
+        return;
+    }
+    std::error_code error;
+    for (const auto &file : std::filesystem::directory_iterator(m_storageDirectory, error)) {
+        const std::filesystem::path &path = file.path();
+        const std::string stem = splitStem(path);
+        const std::string extension = storageExtension(path);
+        // "foo-2.AppImage" both takes suffix 2 of "foo" and is itself the plain name "foo-2".
+        noteStorageName(stem, extension, 0);
+        std::string base;
+        unsigned suffix = 0;
+        if (splitNumericSuffix(stem, base, suffix)) {
+            noteStorageName(base, extension, suffix);
+        }
+    }
+    m_storageNamesScanned = !error;
+}
+
+void AppImageManager::noteStorageName(const std::string &stem, const std::string &extension, unsigned suffix)
+{
+    raiseTo(m_nextStorageSuffix[{ stem, extension }], suffix + 1);
+}
+
 bool AppImageManager::isAutostartEnabled(const std::string &id) const
 {
     auto it = m_entries.find(id);
@@ -376,6 +1152,7 @@ bool AppImageManager::isAutostartEnabled(const std::string &id) const
 
 void AppImageManager::setAutostart(const std::string &id, bool enabled)
 {
+    const auto lock = lockForUpdate();
     auto it = m_entries.find(id);
     if (it == m_entries.end()) {
         throw std::runtime_error("Unknown AppImage id: " + id);
@@ -387,13 +1164,18 @@ void AppImageManager::setAutostart(const std::string &id, bool enabled)
 
     const bool previous = it->second.autostart;
     it->second.autostart = enabled;
+    if (m_batch) {
+        m_batch->changedIds.insert(id);
+        m_batch->autostartIds.insert(id);
+        return;
+    }
     try {
         if (enabled) {
             writeAutostartEntry(it->second);
         } else {
             removeAutostartEntry(id);
         }
-        save();
+        persistEntry(it->second);
     } catch (...) {
         it->second.autostart = previous;
         throw;
@@ -405,6 +1187,119 @@ std::filesystem::path AppImageManager::autostartDirectory() const noexcept
     return m_autostartDirectory;
 }
 
+void AppImageManager::beginBatch()
+{
+    if (m_batch) {
+        throw std::runtime_error("An AppImage batch is already in progress");
+    }
+    m_batch = PendingBatch{ m_entries, {}, {}, {}, {} };
+}
+
+void AppImageManager::commitBatch()
+{
+    if (!m_batch) {
+        throw std::runtime_error("No AppImage batch in progress");
+    }
+
+    PendingBatch batch = std::move(*m_batch);
+    m_batch.reset();
+
+    const ManifestStore::Lock lock(m_manifest);
+    try {
+        if (m_manifest.generation() != m_loadedGeneration) {
+            rebaseBatch(batch);
+        }
+        for (const auto &id : batch.autostartIds) {
+            syncAutostartEntry(id);
+        }
+        persistChanges(batch.changedIds);
+    } catch (...) {
+        restoreBatch(batch);
+        throw;
+    }
+
+    for (const auto &storedPath : batch.removedFiles) {
+        removeStoredFile(storedPath);
+    }
+}
+
+void AppImageManager::rollbackBatch()
+{
+    if (!m_batch) {
+        throw std::runtime_error("No AppImage batch in progress");
+    }
+
+    PendingBatch batch = std::move(*m_batch);
+    m_batch.reset();
+    restoreBatch(batch);
+}
+
+// Another process wrote the manifest while the batch was open: start again from what is
+// on disk and re-apply only the ids the batch changed. An id the batch added that was
+// taken in the meantime is replaced by a fresh one.
+void AppImageManager::rebaseBatch(PendingBatch &batch)
+{
+    EntryMap ours = std::move(m_entries);
+    load();
+
+    std::set<std::string> changedIds;
+    for (const auto &id : batch.changedIds) {
+        const auto existing = m_entries.find(id);
+        const auto changed = ours.find(id);
+        if (changed == ours.end()) {
+            if (existing != m_entries.end()) {
+                unindexEntry(existing->second);
+                m_entries.erase(existing);
+            }
+            changedIds.insert(id);
+            continue;
+        }
+
+        AppImageEntry entry = std::move(changed->second);
+        if (existing != m_entries.end()) {
+            if (batch.snapshot.count(id) == 0) {
+                entry.id = generateId(entry.storedPath);
+                if (batch.autostartIds.erase(id) != 0) {
+                    batch.autostartIds.insert(entry.id);
+                }
+            } else {
+                unindexEntry(existing->second);
+            }
+        }
+        indexEntry(entry);
+        changedIds.insert(entry.id);
+        m_entries[entry.id] = std::move(entry);
+    }
+    batch.changedIds = std::move(changedIds);
+}
+
+void AppImageManager::restoreBatch(PendingBatch &batch)
+{
+    m_entries = std::move(batch.snapshot);
+    rebuildIndexes();
+
+    for (const auto &id : batch.autostartIds) {
+        try {
+            syncAutostartEntry(id);
+        } catch (const std::exception &) {
+            // Best effort; the manifest is authoritative.
+        }
+    }
+
+    for (auto it = batch.importedFiles.rbegin(); it != batch.importedFiles.rend(); ++it) {
+        try {
+            moveForImport(it->first, it->second);
+        } catch (const std::exception &) {
+            // Leave the file in storage rather than lose it.
+        }
+    }
+    // The names just vacated can be handed out again.
+    if (!batch.importedFiles.empty()) {
+        m_nextStorageSuffix.clear();
+        m_storageNamesScanned = false;
+    }
+}
+
 std::filesystem::path AppImageManager::autostartDesktopPath(const std::string &id) const
 {
     return m_autostartDirectory / ("appimagemanager-" + id + ".desktop");
@@ -446,6 +1341,16 @@ void AppImageManager::writeAutostartEntry(const AppImageEntry &entry) const
     stream << "X-GNOME-Autostart-enabled=true\n";
 }
 
+void AppImageManager::syncAutostartEntry(const std::string &id) const
+{
+    const auto it = m_entries.find(id);
+    if (it != m_entries.end() && it->second.autostart) {
+        writeAutostartEntry(it->second);
+    } else {
+        removeAutostartEntry(id);
+    }
+}
+
 void AppImageManager::removeAutostartEntry(const std::string &id) const
 {
     if (m_autostartDirectory.empty()) {
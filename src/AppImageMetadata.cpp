@@ -0,0 +1,122 @@
+#include "AppImageManager/AppImageMetadata.h"
+
+#include "AppImageManager/SquashFsReader.h"
+
+#include <exception>
+
+namespace appimagelauncher {
+
+namespace {
+
+std::string_view trimmed(std::string_view value)
+{
+    const auto first = value.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    const auto last = value.find_last_not_of(" \t\r");
+    return value.substr(first, last - first + 1);
+}
+
+// Expands the escapes the desktop entry specification allows in string values.
+std::string unescape(std::string_view value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        if (value[i] != '\\' || i + 1 == value.size()) {
+            result += value[i];
+            continue;
+        }
+        switch (value[++i]) {
+        case 's':
+            result += ' ';
+            break;
+        case 'n':
+            result += '\n';
+            break;
+        case 't':
+            result += '\t';
+            break;
+        case 'r':
+            result += '\r';
+            break;
+        default:
+            result += value[i];
+            break;
+        }
+    }
+    return result;
+}
+
+bool endsWith(std::string_view value, std::string_view suffix)
+{
+    return value.size() >= suffix.size() && value.substr(value.size() - suffix.size()) == suffix;
+}
+
+} // namespace
+
+AppImageMetadata parseDesktopEntry(std::string_view contents)
+{
+    AppImageMetadata metadata;
+    bool inDesktopEntry = false;
+    while (!contents.empty()) {
+        const auto end = contents.find('\n');
+        const std::string_view line = trimmed(contents.substr(0, end));
+        contents.remove_prefix(end == std::string_view::npos ? contents.size() : end + 1);
+
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        if (line.front() == '[') {
+            // Only the first group counts; actions and other groups follow it.
+            if (inDesktopEntry) {
+                break;
+            }
+            inDesktopEntry = line == "[Desktop Entry]";
+            continue;
+        }
+        if (!inDesktopEntry) {
+            continue;
+        }
+
+        const auto separator = line.find('=');
+        if (separator == std::string_view::npos) {
+            continue;
+        }
+        const std::string_view key = trimmed(line.substr(0, separator));
+        const std::string_view value = trimmed(line.substr(separator + 1));
+        if (key == "Name") {
+            metadata.name = unescape(value);
+        } else if (key == "X-AppImage-Version") {
+            metadata.version = unescape(value);
+        } else if (key == "Categories") {
+            metadata.categories = unescape(value);
+        } else if (key == "Comment") {
+            metadata.comment = unescape(value);
+        } else if (key == "Icon") {
+            metadata.icon = unescape(value);
+        }
+    }
+    return metadata;
+}
+
+AppImageMetadata readAppImageMetadata(const std::filesystem::path &path)
+{
+    try {
+        const SquashFsReader reader(path);
+        for (const auto &entry : reader.listDirectory("/")) {
+            if (entry.type == SquashFsReader::EntryType::Directory || !endsWith(entry.name, ".desktop")) {
+                continue;
+            }
+            if (const auto contents = reader.readFile(entry.name)) {
+                return parseDesktopEntry(*contents);
+            }
+        }
+    } catch (const std::exception &) {
+        // Type 1 and damaged AppImages simply have no metadata.
+    }
+    return {};
+}
+
+} // namespace appimagelauncher
@@ -0,0 +1,153 @@
+#include "AppImageManager/AppImageValidator.h"
+
+#include "AppImageManager/SquashFsReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace appimagelauncher {
+
+namespace {
+
+constexpr std::size_t kElfHeaderSize = 64;
+constexpr std::uint32_t kSquashFsMagic = 0x73717368;
+constexpr std::size_t kSquashFsSuperblockSize = 96;
+// The primary volume descriptor is the first one, in sector 16.
+constexpr std::uint64_t kIsoDescriptorOffset = 16 * 2048;
+constexpr std::size_t kIsoDescriptorSize = 136;
+
+template <typename T>
+T readLe(const unsigned char *data)
+{
+    T value = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+class FileReader {
+public:
+    explicit FileReader(const std::filesystem::path &path)
+        : m_fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC))
+    {
+        if (m_fd < 0) {
+            throw std::runtime_error("Unable to open " + path.string() + ": " + std::strerror(errno));
+        }
+    }
+    ~FileReader() { ::close(m_fd); }
+    FileReader(const FileReader &) = delete;
+    FileReader &operator=(const FileReader &) = delete;
+
+    int fd() const noexcept { return m_fd; }
+
+    // Returns how many bytes were read; short only at the end of the file.
+    std::size_t read(std::uint64_t offset, unsigned char *buffer, std::size_t size) const
+    {
+        std::size_t done = 0;
+        while (done < size) {
+            const ssize_t result = ::pread(m_fd, buffer + done, size - done, static_cast<off_t>(offset + done));
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result <= 0) {
+                break;
+            }
+            done += static_cast<std::size_t>(result);
+        }
+        return done;
+    }
+
+private:
+    int m_fd;
+};
+
+std::runtime_error invalid(const std::filesystem::path &path, const char *reason)
+{
+    return std::runtime_error(path.string() + " is not a valid AppImage: " + reason);
+}
+
+} // namespace
+
+AppImageFormat validateAppImage(const std::filesystem::path &path)
+{
+    const FileReader file(path);
+    struct stat info {};
+    if (::fstat(file.fd(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        throw invalid(path, "not a regular file");
+    }
+    const auto fileSize = static_cast<std::uint64_t>(info.st_size);
+
+    unsigned char header[kElfHeaderSize] = {};
+    const std::size_t headerSize = file.read(0, header, sizeof(header));
+    if (headerSize < 16 || std::memcmp(header, "\x7f" "ELF", 4) != 0) {
+        throw invalid(path, "no ELF header");
+    }
+    if (header[8] != 'A' || header[9] != 'I' || (header[10] != 1 && header[10] != 2)) {
+        throw invalid(path, "no AppImage magic bytes");
+    }
+    const auto runtimeSize = SquashFsReader::elfPayloadOffset(header, headerSize, fileSize);
+    if (!runtimeSize) {
+        throw invalid(path, "malformed ELF header");
+    }
+
+    AppImageFormat format;
+    format.type = header[10];
+    format.machine = header[5] == 2 ? (header[18] << 8 | header[19]) : (header[19] << 8 | header[18]);
+
+    if (format.type == 2) {
+        unsigned char superblock[kSquashFsSuperblockSize] = {};
+        if (file.read(*runtimeSize, superblock, sizeof(superblock)) != sizeof(superblock)
+            || readLe<std::uint32_t>(superblock) != kSquashFsMagic) {
+            throw invalid(path, "no SquashFS payload after the runtime");
+        }
+        const auto blockSize = readLe<std::uint32_t>(superblock + 12);
+        const auto blockLog = readLe<std::uint16_t>(superblock + 22);
+        if (readLe<std::uint16_t>(superblock + 28) != 4 || blockLog < 12 || blockLog > 20
+            || blockSize != (1u << blockLog)) {
+            throw invalid(path, "malformed SquashFS superblock");
+        }
+        format.payloadOffset = *runtimeSize;
+        format.payloadSize = readLe<std::uint64_t>(superblock + 40);
+        format.metadataOffset = std::min(readLe<std::uint64_t>(superblock + 64), format.payloadSize);
+    } else {
+        unsigned char descriptor[kIsoDescriptorSize] = {};
+        if (file.read(kIsoDescriptorOffset, descriptor, sizeof(descriptor)) != sizeof(descriptor)
+            || descriptor[0] != 1 || std::memcmp(descriptor + 1, "CD001", 5) != 0) {
+            throw invalid(path, "no ISO 9660 image");
+        }
+        format.payloadSize = static_cast<std::uint64_t>(readLe<std::uint32_t>(descriptor + 80))
+            * readLe<std::uint16_t>(descriptor + 128);
+    }
+
+    if (format.payloadSize > fileSize - format.payloadOffset) {
+        throw invalid(path, "payload is truncated");
+    }
+    return format;
+}
+
+std::string machineName(std::uint32_t machine)
+{
+    switch (machine) {
+    case 3:
+        return "i386";
+    case 40:
+        return "armhf";
+    case 62:
+        return "x86_64";
+    case 183:
+        return "aarch64";
+    case 243:
+        return "riscv64";
+    default:
+        return "machine " + std::to_string(machine);
+    }
+}
+
+} // namespace appimagelauncher
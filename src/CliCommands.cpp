@@ -0,0 +1,535 @@
+#include "AppImageManager/CliCommands.h"
+
+#include "AppImageManager/AppImageMetadata.h"
+#include "AppImageManager/IntegrityVerifier.h"
+#include "AppImageManager/LaunchPrefetcher.h"
+#include "AppImageManager/SearchIndex.h"
+#include "AppImageManager/Sha256.h"
+
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <exception>
+#include <filesystem>
+#include <iomanip>
+#include <set>
+#include <stdexcept>
+
+namespace appimagelauncher {
+
+namespace {
+
+bool hasAppImageExtension(const std::filesystem::path &path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char ch) { return std::tolower(ch); });
+    return extension == ".appimage";
+}
+
+} // namespace
+
+std::vector<std::filesystem::path> collectAppImagePaths(const std::vector<std::string> &arguments)
+{
+    std::vector<std::filesystem::path> paths;
+    for (const auto &value : arguments) {
+        const std::filesystem::path argument = value;
+        if (!std::filesystem::is_directory(argument)) {
+            paths.push_back(argument);
+            continue;
+        }
+
+        std::vector<std::filesystem::path> found;
+        for (const auto &item : std::filesystem::directory_iterator(argument)) {
+            if (item.is_regular_file() && hasAppImageExtension(item.path())) {
+                found.push_back(item.path());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        paths.insert(paths.end(), found.begin(), found.end());
+    }
+    return paths;
+}
+
+namespace {
+
+int runAddCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    if (arguments.empty()) {
+        err << "Missing AppImage path for add command" << std::endl;
+        return 1;
+    }
+    const auto paths = collectAppImagePaths(arguments);
+    if (paths.empty()) {
+        err << "No AppImages found to add" << std::endl;
+        return 1;
+    }
+
+    std::vector<AppImageEntry> added;
+    added.reserve(paths.size());
+    AppImageManager::Batch batch(manager);
+    for (const auto &path : paths) {
+        added.push_back(manager.addAppImage(path, true));
+    }
+    batch.commit();
+
+    for (const auto &entry : added) {
+        out << "Added AppImage: " << entry.id << " (" << entry.storedPath << ")" << std::endl;
+    }
+    return 0;
+}
+
+int runRemoveCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    if (arguments.empty()) {
+        err << "Missing AppImage id" << std::endl;
+        return 1;
+    }
+    manager.removeAppImage(arguments[0]);
+    out << "Removed AppImage: " << arguments[0] << std::endl;
+    return 0;
+}
+
+int runDedupeCommand(AppImageManager &manager, std::ostream &out)
+{
+    const auto result = manager.dedupe();
+    out << "Hashed " << result.hashed << " AppImage(s), linked " << result.linked << " duplicate(s), reclaimed "
+        << result.reclaimedBytes << " bytes" << std::endl;
+    return 0;
+}
+
+int runVerifyCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    std::vector<AppImageEntry> entries;
+    if (arguments.empty()) {
+        entries = manager.entries();
+    } else {
+        for (const auto &id : arguments) {
+            const auto entry = manager.entryById(id);
+            if (!entry) {
+                err << "Unknown AppImage id: " << id << std::endl;
+                return 1;
+            }
+            entries.push_back(*entry);
+        }
+    }
+
+    const VerifyReport report = verifyEntries(entries);
+    std::size_t notHashed = 0;
+    for (const auto &result : report.results) {
+        if (result.status == VerifyStatus::Ok) {
+            continue;
+        }
+        notHashed += result.status == VerifyStatus::NotHashed ? 1 : 0;
+        out << verifyStatusName(result.status) << "\t" << result.id << "\t" << result.storedPath;
+        if (!result.error.empty()) {
+            out << "\t" << result.error;
+        }
+        out << std::endl;
+    }
+
+    const std::size_t failures = report.failureCount();
+    out << "Verified " << report.results.size() << " AppImage(s): " << failures << " failed";
+    if (notHashed > 0) {
+        out << ", " << notHashed << " not hashed (run dedupe to record their hashes)";
+    }
+    out << std::fixed << std::setprecision(2) << "; hashed " << static_cast<double>(report.bytesHashed) / 1e9
+        << " GB in " << report.seconds << " s (" << report.gigabytesPerSecond() << " GB/s, "
+        << Sha256::implementation() << ")" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+void printStorageIssues(const StorageReport &report, std::ostream &out)
+{
+    for (const auto &issue : report.issues) {
+        out << storageIssueName(issue.kind) << "\t" << issue.id << "\t" << issue.path;
+        if (!issue.error.empty()) {
+            out << "\t" << issue.error;
+        }
+        out << std::endl;
+    }
+}
+
+int runFsckCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    bool repair = false;
+    for (const auto &argument : arguments) {
+        if (argument == "--repair") {
+            repair = true;
+        } else {
+            err << "Unknown fsck option: " << argument << std::endl;
+            return 1;
+        }
+    }
+
+    const StorageReport report = manager.checkStorage();
+    printStorageIssues(report, out);
+    out << "Scanned " << report.filesScanned << " file(s) in " << std::fixed << std::setprecision(2) << report.seconds
+        << " s: " << report.issues.size() << " problem(s), " << report.reclaimableBytes << " bytes reclaimable"
+        << std::endl;
+    if (!repair) {
+        if (!report.issues.empty()) {
+            out << "Run gc to repair them" << std::endl;
+        }
+        return report.issues.empty() ? 0 : 1;
+    }
+
+    const auto result = manager.repairStorage(report);
+    out << "Repaired " << result.repaired << " problem(s), reclaimed " << result.reclaimedBytes << " bytes";
+    if (result.skipped > 0) {
+        out << "; " << result.skipped << " no longer applied or could not be repaired";
+    }
+    out << std::endl;
+    return 0;
+}
+
+int runPrefetchCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    std::size_t count = kDefaultPrefetchCount;
+    try {
+        if (!arguments.empty()) {
+            if (arguments.size() != 2 || arguments[0] != "--top") {
+                throw std::invalid_argument(arguments[0]);
+            }
+            count = std::stoul(arguments[1]);
+        }
+    } catch (const std::logic_error &) {
+        err << "Usage: appimagemanager prefetch [--top <count>]" << std::endl;
+        return 1;
+    }
+
+    const std::uint64_t budget = prefetchBudget();
+    std::uint64_t requested = 0;
+    const auto results = prefetchHottest(manager.entries(), LaunchHistory(manager.launchHistoryPath()), count, budget);
+    for (const auto &result : results) {
+        out << result.id << "\t" << std::fixed << std::setprecision(1) << 100.0 * result.residency() << "% cached\t"
+            << result.requestedBytes << " bytes requested";
+        if (!result.error.empty()) {
+            out << "\t" << result.error;
+        }
+        out << std::endl;
+        requested += result.requestedBytes;
+    }
+    out << "Requested " << requested << " bytes for " << results.size() << " AppImage(s) within a budget of " << budget
+        << " bytes" << std::endl;
+    return 0;
+}
+
+int runLaunchesCommand(AppImageManager &manager, std::ostream &out)
+{
+    for (const auto &stats : LaunchHistory(manager.launchHistoryPath()).stats()) {
+        const auto entry = manager.entryById(stats.id);
+        const std::time_t lastLaunch = static_cast<std::time_t>(stats.lastLaunch);
+        std::tm local {};
+        ::localtime_r(&lastLaunch, &local);
+        out << stats.id << "\t" << stats.launches << " launches\t" << stats.launches - stats.coldLaunches << " warm\t"
+            << stats.coldLaunches << " cold\t" << std::fixed << std::setprecision(1) << 100.0 * stats.meanResidency
+            << "% cached at launch\t";
+        if (entry) {
+            out << 100.0 * pageCacheResidency(entry->storedPath).residency() << "% cached now\t";
+        } else {
+            out << "removed\t";
+        }
+        out << std::put_time(&local, "%Y-%m-%d %H:%M") << std::endl;
+    }
+    return 0;
+}
+
+int runUpdateCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    std::string source;
+    std::string id;
+    for (std::size_t i = 0; i < arguments.size(); ++i) {
+        const std::string &argument = arguments[i];
+        if (argument == "--from" && i + 1 < arguments.size()) {
+            source = arguments[++i];
+        } else if (argument.rfind("--from=", 0) == 0) {
+            source = argument.substr(std::string("--from=").size());
+        } else if (id.empty() && argument.rfind("--", 0) != 0) {
+            id = argument;
+        } else {
+            err << "Unknown update option: " << argument << std::endl;
+            return 1;
+        }
+    }
+    if (id.empty() || source.empty()) {
+        err << "Usage: appimagemanager update <id> --from <file.zsync|mirror-directory>" << std::endl;
+        return 1;
+    }
+
+    const auto result = manager.updateAppImage(id, source);
+    if (result.upToDate) {
+        out << id << " is already up to date (" << result.controlFile << ")" << std::endl;
+        return 0;
+    }
+    const double reused = result.targetSize > 0 ? 100.0 * static_cast<double>(result.reusedBytes) / result.targetSize : 0.0;
+    out << "Updated " << id << " from " << result.controlFile << ": reused " << result.reusedBytes << " of "
+        << result.targetSize << " bytes (" << std::fixed << std::setprecision(1) << reused << "%), read "
+        << result.fetchedBytes << " bytes from " << result.targetFile << std::endl;
+    return 0;
+}
+
+int runVersionsCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    if (arguments.empty()) {
+        err << "Usage: appimagemanager versions <id> [--keep <count>]" << std::endl;
+        return 1;
+    }
+    const std::string &id = arguments[0];
+    if (arguments.size() > 1) {
+        std::size_t keep = 0;
+        try {
+            if (arguments.size() != 3 || arguments[1] != "--keep") {
+                throw std::invalid_argument(arguments[1]);
+            }
+            keep = std::stoul(arguments[2]);
+        } catch (const std::logic_error &) {
+            err << "Usage: appimagemanager versions <id> [--keep <count>]" << std::endl;
+            return 1;
+        }
+        out << "Removed " << manager.pruneVersions(id, keep) << " version(s) of " << id << std::endl;
+    }
+
+    for (const auto &version : manager.versions(id)) {
+        out << version.number << "\t" << (version.active ? "active" : "") << "\t"
+            << readAppImageMetadata(version.path).version << "\t" << version.path << std::endl;
+    }
+    return 0;
+}
+
+int runAddVersionCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    if (arguments.size() != 2) {
+        err << "Usage: appimagemanager add-version <id> <path>" << std::endl;
+        return 1;
+    }
+    const auto before = manager.versions(arguments[0]);
+    const auto entry = manager.addVersion(arguments[0], arguments[1]);
+    const bool kept = std::any_of(before.begin(), before.end(),
+        [&entry](const AppImageManager::Version &version) { return version.number == entry.activeVersion; });
+    out << (kept ? "Already kept as version " : "Added version ") << entry.activeVersion << " of " << entry.id << " ("
+        << entry.storedPath << ")" << std::endl;
+    return 0;
+}
+
+int runRollbackCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    if (arguments.empty() || arguments.size() > 2) {
+        err << "Usage: appimagemanager rollback <id> [version]" << std::endl;
+        return 1;
+    }
+    AppImageEntry entry;
+    if (arguments.size() == 2) {
+        unsigned number = 0;
+        try {
+            number = static_cast<unsigned>(std::stoul(arguments[1]));
+        } catch (const std::logic_error &) {
+            err << "Invalid version number: " << arguments[1] << std::endl;
+            return 1;
+        }
+        entry = manager.activateVersion(arguments[0], number);
+    } else {
+        entry = manager.rollback(arguments[0]);
+    }
+    out << "Activated version " << entry.activeVersion << " of " << entry.id;
+    if (!entry.version.empty()) {
+        out << " (" << entry.version << ")";
+    }
+    out << std::endl;
+    return 0;
+}
+
+} // namespace
+
+void printUsage(std::ostream &out)
+{
+    out << "AppImage Manager\n"
+        << "Usage:\n"
+        << "  appimagemanager                # Launch the graphical interface\n"
+        << "  appimagemanager add <path>...  # Add AppImages (files or directories) and move them under management\n"
+        << "  appimagemanager remove <id>    # Remove a managed AppImage\n"
+        << "  appimagemanager list [--filter <query>]  # List managed AppImages, optionally only matching ones\n"
+        << "  appimagemanager search <query>...  # List AppImages whose name, id or categories match every term\n"
+        << "  appimagemanager autostart <id> <on|off>  # Enable or disable autostart for an AppImage\n"
+        << "  appimagemanager open <target>  # Open AppImage by id or path (prompts when new)\n"
+        << "  appimagemanager verify [id]... # Re-hash stored AppImages and compare with their recorded hashes\n"
+        << "  appimagemanager dedupe         # Hardlink stored AppImages with identical content\n"
+        << "  appimagemanager update <id> --from <file.zsync|dir>  # Update from a local zsync mirror, reusing unchanged blocks\n"
+        << "  appimagemanager add-version <id> <path>  # Make a newer build the active version of an AppImage\n"
+        << "  appimagemanager versions <id> [--keep <n>]  # List kept versions, optionally deleting all but the newest n\n"
+        << "  appimagemanager rollback <id> [version]  # Switch back to the previous (or the given) version\n"
+        << "  appimagemanager fsck [--repair]  # Check storage and autostart entries against the manifest\n"
+        << "  appimagemanager gc             # Same as fsck --repair: register, restore or delete what does not match\n"
+        << "  appimagemanager launches       # Show how often AppImages were launched and how many launches were cold\n"
+        << "  appimagemanager prefetch [--top <n>]  # Warm the page cache for the most launched AppImages\n"
+        << "  appimagemanager storage-dir    # Print the dedicated storage directory\n"
+        << "  appimagemanager manifest       # Print the manifest file path\n"
+        << "  appimagemanager export-manifest [path]  # Export the manifest as TSV for older releases\n"
+        << "  appimagemanager daemon [stop]  # Run (or stop) the resident launcher daemon\n";
+}
+
+int runCliCommand(const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    if (arguments.empty() || arguments[0] == "help") {
+        printUsage(out);
+        return 0;
+    }
+
+    const std::string &command = arguments[0];
+    if (command == "open") {
+        return kRequiresQtExitCode;
+    }
+
+    static const std::set<std::string> kCommands = {
+        "add", "remove", "list", "search", "autostart", "verify", "dedupe", "update", "add-version", "versions",
+        "rollback", "fsck", "gc", "launches", "prefetch", "storage-dir", "manifest",
+        "export-manifest"
+    };
+    if (kCommands.find(command) == kCommands.end()) {
+        err << "Unknown command: " << command << std::endl;
+        printUsage(out);
+        return 1;
+    }
+
+    const std::vector<std::string> rest(arguments.begin() + 1, arguments.end());
+    try {
+        AppImageManager manager;
+
+        if (command == "add") {
+            return runAddCommand(manager, rest, out, err);
+        }
+        if (command == "remove") {
+            return runRemoveCommand(manager, rest, out, err);
+        }
+        if (command == "list") {
+            return runListCommand(manager, rest, out, err);
+        }
+        if (command == "search") {
+            return runSearchCommand(manager, rest, out, err);
+        }
+        if (command == "autostart") {
+            return runAutostartCommand(manager, rest, out, err);
+        }
+        if (command == "verify") {
+            return runVerifyCommand(manager, rest, out, err);
+        }
+        if (command == "dedupe") {
+            return runDedupeCommand(manager, out);
+        }
+        if (command == "update") {
+            return runUpdateCommand(manager, rest, out, err);
+        }
+        if (command == "add-version") {
+            return runAddVersionCommand(manager, rest, out, err);
+        }
+        if (command == "versions") {
+            return runVersionsCommand(manager, rest, out, err);
+        }
+        if (command == "rollback") {
+            return runRollbackCommand(manager, rest, out, err);
+        }
+        if (command == "fsck") {
+            return runFsckCommand(manager, rest, out, err);
+        }
+        if (command == "gc") {
+            std::vector<std::string> repair = rest;
+            repair.push_back("--repair");
+            return runFsckCommand(manager, repair, out, err);
+        }
+        if (command == "launches") {
+            return runLaunchesCommand(manager, out);
+        }
+        if (command == "prefetch") {
+            return runPrefetchCommand(manager, rest, out, err);
+        }
+        if (command == "storage-dir") {
+            out << manager.storageDirectory() << std::endl;
+            return 0;
+        }
+        if (command == "manifest") {
+            out << manager.manifestPath() << std::endl;
+            return 0;
+        }
+
+        const auto target = manager.exportManifest(rest.empty() ? std::filesystem::path() : std::filesystem::path(rest[0]));
+        out << "Exported manifest to " << target << std::endl;
+        return 0;
+    } catch (const std::exception &error) {
+        err << "Error: " << error.what() << std::endl;
+        return 1;
+    }
+}
+
+int runListCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    std::string filter;
+    for (std::size_t i = 0; i < arguments.size(); ++i) {
+        const std::string &argument = arguments[i];
+        if (argument == "--filter") {
+            if (i + 1 == arguments.size()) {
+                err << "Missing query for --filter" << std::endl;
+                return 1;
+            }
+            filter = arguments[++i];
+        } else if (argument.rfind("--filter=", 0) == 0) {
+            filter = argument.substr(std::string("--filter=").size());
+        } else {
+            err << "Unknown list option: " << argument << std::endl;
+            return 1;
+        }
+    }
+
+    const auto entries = manager.entries();
+    SearchIndex index;
+    if (!filter.empty()) {
+        index.rebuild(entries);
+        index.setQuery(filter);
+    }
+    for (const auto &entry : entries) {
+        if (!index.matches(entry.id)) {
+            continue;
+        }
+        out << entry.id << "\t" << entry.name << "\t" << entry.storedPath
+            << "\t" << (entry.autostart ? "autostart" : "")
+            << "\t" << entry.version << "\t" << entry.categories << std::endl;
+    }
+    return 0;
+}
+
+int runSearchCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    if (arguments.empty()) {
+        err << "Usage: appimagemanager search <query>..." << std::endl;
+        return 1;
+    }
+
+    std::string query;
+    for (const auto &argument : arguments) {
+        query += (query.empty() ? "" : " ") + argument;
+    }
+    return runListCommand(manager, { "--filter", query }, out, err);
+}
+
+int runAutostartCommand(AppImageManager &manager, const std::vector<std::string> &arguments, std::ostream &out, std::ostream &err)
+{
+    if (arguments.size() < 2) {
+        err << "Usage: appimagemanager autostart <id> <on|off>" << std::endl;
+        return 1;
+    }
+    const std::string &id = arguments[0];
+    const std::string &state = arguments[1];
+    bool enable;
+    if (state == "on" || state == "enable" || state == "true") {
+        enable = true;
+    } else if (state == "off" || state == "disable" || state == "false") {
+        enable = false;
+    } else {
+        err << "Unknown autostart state: " << state << std::endl;
+        return 1;
+    }
+
+    manager.setAutostart(id, enable);
+    out << (enable ? "Enabled" : "Disabled") << " autostart for " << id << std::endl;
+    return 0;
+}
+
+} // namespace appimagelauncher
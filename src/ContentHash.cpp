@@ -0,0 +1,72 @@
+#include "AppImageManager/ContentHash.h"
+
+#include "AppImageManager/MappedFile.h"
+#include "AppImageManager/Sha256.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace appimagelauncher {
+
+namespace {
+constexpr unsigned kMaxHashThreads = 8;
+} // namespace
+
+std::string contentHash(const unsigned char *data, std::size_t size, unsigned threads)
+{
+    const std::size_t chunkCount = std::max<std::size_t>(1, (size + kContentHashChunkSize - 1) / kContentHashChunkSize);
+    std::vector<Sha256::Digest> digests(chunkCount);
+
+    if (threads == 0) {
+        threads = std::min(kMaxHashThreads, std::max(1u, std::thread::hardware_concurrency()));
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, chunkCount));
+
+    // Workers claim chunks in order, so the pages they touch stay close to one another and
+    // readahead keeps working.
+    std::atomic<std::size_t> nextChunk { 0 };
+    const auto worker = [&]() {
+        for (std::size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++) {
+            const std::size_t offset = chunk * kContentHashChunkSize;
+            const std::size_t length = std::min(kContentHashChunkSize, size - std::min(size, offset));
+            digests[chunk] = Sha256::digest(data + offset, length);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads > 0 ? threads - 1 : 0);
+    for (unsigned i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : pool) {
+        thread.join();
+    }
+
+    Sha256 root;
+    for (const auto &digest : digests) {
+        root.update(digest.data(), digest.size());
+    }
+    std::uint8_t sizeBytes[8];
+    for (int i = 0; i < 8; ++i) {
+        sizeBytes[i] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(size) >> (8 * i));
+    }
+    root.update(sizeBytes, sizeof(sizeBytes));
+    return Sha256::toHex(root.finish());
+}
+
+std::string contentHashOfFile(const std::filesystem::path &path, unsigned threads)
+{
+    const MappedFile file(path);
+    if (file.size() > 0) {
+        ::madvise(const_cast<unsigned char *>(file.data()), file.size(), MADV_SEQUENTIAL);
+    }
+    return contentHash(file.data(), file.size(), threads);
+}
+
+} // namespace appimagelauncher
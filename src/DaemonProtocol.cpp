@@ -0,0 +1,175 @@
+#include "AppImageManager/DaemonProtocol.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace appimagelauncher {
+
+namespace {
+
+constexpr int kReplyTimeoutMilliseconds = 10000;
+
+bool sendAll(int fd, std::string_view data)
+{
+    while (!data.empty()) {
+        const ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data.remove_prefix(static_cast<std::size_t>(sent));
+    }
+    return true;
+}
+
+std::optional<DaemonReply> decodeDaemonReply(const std::string &data)
+{
+    const auto headerEnd = data.find('\n');
+    const auto separator = data.find('\t');
+    if (headerEnd == std::string::npos || separator == std::string::npos || separator > headerEnd) {
+        return std::nullopt;
+    }
+
+    char *end = nullptr;
+    const long exitCode = std::strtol(data.c_str(), &end, 10);
+    if (end != data.c_str() + separator) {
+        return std::nullopt;
+    }
+    const unsigned long outLength = std::strtoul(data.c_str() + separator + 1, &end, 10);
+    if (end != data.c_str() + headerEnd || outLength > data.size() - headerEnd - 1) {
+        return std::nullopt;
+    }
+
+    DaemonReply reply;
+    reply.exitCode = static_cast<int>(exitCode);
+    reply.out = data.substr(headerEnd + 1, outLength);
+    reply.err = data.substr(headerEnd + 1 + outLength);
+    return reply;
+}
+
+} // namespace
+
+std::filesystem::path daemonSocketPath()
+{
+    if (const char *runtimeDirectory = std::getenv("XDG_RUNTIME_DIR")) {
+        if (*runtimeDirectory != '\0') {
+            return std::filesystem::path(runtimeDirectory) / "appimagemanager.sock";
+        }
+    }
+    return std::filesystem::temp_directory_path() / ("appimagemanager-" + std::to_string(::getuid()) + ".sock");
+}
+
+std::optional<std::string> encodeDaemonRequest(const DaemonRequest &request)
+{
+    std::string line = request.workingDirectory.string();
+    if (line.find_first_of("\t\n") != std::string::npos) {
+        return std::nullopt;
+    }
+    for (const auto &argument : request.arguments) {
+        if (argument.find_first_of("\t\n") != std::string::npos) {
+            return std::nullopt;
+        }
+        line += '\t';
+        line += argument;
+    }
+    line += '\n';
+    return line;
+}
+
+DaemonRequest decodeDaemonRequest(std::string_view line)
+{
+    while (!line.empty() && line.back() == '\n') {
+        line.remove_suffix(1);
+    }
+
+    std::vector<std::string> fields;
+    std::size_t start = 0;
+    while (start <= line.size()) {
+        const auto tab = line.find('\t', start);
+        const auto end = tab == std::string_view::npos ? line.size() : tab;
+        fields.emplace_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+
+    DaemonRequest request;
+    request.workingDirectory = fields.front();
+    request.arguments.assign(fields.begin() + 1, fields.end());
+    return request;
+}
+
+std::string encodeDaemonReply(const DaemonReply &reply)
+{
+    std::string data = std::to_string(reply.exitCode) + '\t' + std::to_string(reply.out.size()) + '\n';
+    data += reply.out;
+    data += reply.err;
+    return data;
+}
+
+std::optional<DaemonReply> requestDaemon(const std::vector<std::string> &arguments)
+{
+    std::error_code error;
+    const auto workingDirectory = std::filesystem::current_path(error);
+    if (error) {
+        return std::nullopt;
+    }
+    const auto request = encodeDaemonRequest({ workingDirectory, arguments });
+    if (!request) {
+        return std::nullopt;
+    }
+
+    const std::string socketPath = daemonSocketPath().string();
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        return std::nullopt;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || !sendAll(fd, *request)) {
+        ::close(fd);
+        return std::nullopt;
+    }
+
+    // Once the daemon has the request it may already have acted on it, so from here on a
+    // failure is reported instead of silently retrying in-process.
+    std::string data;
+    char buffer[4096];
+    pollfd descriptor { fd, POLLIN, 0 };
+    for (;;) {
+        const int ready = ::poll(&descriptor, 1, kReplyTimeoutMilliseconds);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            break;
+        }
+        const ssize_t received = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            break;
+        }
+        data.append(buffer, static_cast<std::size_t>(received));
+    }
+    ::close(fd);
+
+    if (auto reply = decodeDaemonReply(data)) {
+        return reply;
+    }
+    return DaemonReply{ 1, {}, "No valid reply from the AppImage Manager daemon\n" };
+}
+
+} // namespace appimagelauncher
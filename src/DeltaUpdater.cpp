@@ -0,0 +1,792 @@
+#include "AppImageManager/DeltaUpdater.h"
+
+#include "AppImageManager/FileDescriptor.h"
+#include "AppImageManager/MappedFile.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace appimagelauncher {
+
+namespace {
+
+constexpr std::size_t kCopyBufferSize = 1u << 20;
+// Bits in the prefilter per target block; most window positions are rejected by one
+// bit test instead of a lookup.
+constexpr std::size_t kFilterBitsPerBlock = 16;
+
+using Md4Digest = std::array<std::uint8_t, 16>;
+
+std::uint32_t rotl(std::uint32_t value, int shift)
+{
+    return (value << shift) | (value >> (32 - shift));
+}
+
+std::uint32_t readLe32(const unsigned char *data)
+{
+    return std::uint32_t(data[0]) | std::uint32_t(data[1]) << 8 | std::uint32_t(data[2]) << 16
+        | std::uint32_t(data[3]) << 24;
+}
+
+std::uint32_t readBe32(const unsigned char *data)
+{
+    return std::uint32_t(data[0]) << 24 | std::uint32_t(data[1]) << 16 | std::uint32_t(data[2]) << 8
+        | std::uint32_t(data[3]);
+}
+
+std::uint64_t readElf(const unsigned char *data, std::size_t size, bool bigEndian)
+{
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        const unsigned char byte = data[bigEndian ? i : size - 1 - i];
+        value = (value << 8) | byte;
+    }
+    return value;
+}
+
+// MD4 (RFC 1320), which zsync uses for its per-block checksums. Blocks are small, so this
+// only needs the one-shot form.
+Md4Digest md4(const unsigned char *data, std::size_t size)
+{
+    std::uint32_t state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    const auto compress = [&state](const unsigned char *block) {
+        static constexpr int kOrder2[16] = { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 };
+        static constexpr int kOrder3[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+        static constexpr int kShifts[3][4] = { { 3, 7, 11, 19 }, { 3, 5, 9, 13 }, { 3, 9, 11, 15 } };
+        std::uint32_t x[16];
+        for (int i = 0; i < 16; ++i) {
+            x[i] = readLe32(block + 4 * i);
+        }
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        const auto step = [&](std::uint32_t f, std::uint32_t word, int shift) {
+            const std::uint32_t result = rotl(a + f + word, shift);
+            a = d;
+            d = c;
+            c = b;
+            b = result;
+        };
+        for (int i = 0; i < 16; ++i) {
+            step((b & c) | (~b & d), x[i], kShifts[0][i % 4]);
+        }
+        for (int i = 0; i < 16; ++i) {
+            step((b & c) | (b & d) | (c & d), x[kOrder2[i]] + 0x5a827999, kShifts[1][i % 4]);
+        }
+        for (int i = 0; i < 16; ++i) {
+            step(b ^ c ^ d, x[kOrder3[i]] + 0x6ed9eba1, kShifts[2][i % 4]);
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    };
+
+    std::size_t offset = 0;
+    for (; size - offset >= 64; offset += 64) {
+        compress(data + offset);
+    }
+    unsigned char tail[128] = {};
+    const std::size_t remaining = size - offset;
+    std::memcpy(tail, data + offset, remaining);
+    tail[remaining] = 0x80;
+    const std::size_t tailSize = remaining < 56 ? 64 : 128;
+    const std::uint64_t bits = static_cast<std::uint64_t>(size) * 8;
+    for (int i = 0; i < 8; ++i) {
+        tail[tailSize - 8 + i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+    for (std::size_t block = 0; block < tailSize; block += 64) {
+        compress(tail + block);
+    }
+
+    Md4Digest digest;
+    for (int i = 0; i < 16; ++i) {
+        digest[i] = static_cast<std::uint8_t>(state[i / 4] >> (8 * (i % 4)));
+    }
+    return digest;
+}
+
+// SHA-1 (FIPS 180-4), which zsync control files give for the whole target.
+class Sha1 {
+public:
+    void update(const unsigned char *data, std::size_t size)
+    {
+        m_length += size;
+        if (m_buffered > 0) {
+            const std::size_t take = std::min(size, sizeof(m_buffer) - m_buffered);
+            std::memcpy(m_buffer + m_buffered, data, take);
+            m_buffered += take;
+            data += take;
+            size -= take;
+            if (m_buffered < sizeof(m_buffer)) {
+                return;
+            }
+            compress(m_buffer);
+            m_buffered = 0;
+        }
+        for (; size >= 64; data += 64, size -= 64) {
+            compress(data);
+        }
+        std::memcpy(m_buffer, data, size);
+        m_buffered = size;
+    }
+
+    std::string finishHex()
+    {
+        const std::uint64_t bits = m_length * 8;
+        const unsigned char pad = 0x80;
+        update(&pad, 1);
+        const unsigned char zero = 0;
+        while (m_buffered != 56) {
+            update(&zero, 1);
+        }
+        unsigned char length[8];
+        for (int i = 0; i < 8; ++i) {
+            length[i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+        }
+        update(length, sizeof(length));
+
+        std::string hex;
+        char digits[9];
+        for (const std::uint32_t word : m_state) {
+            std::snprintf(digits, sizeof(digits), "%08x", word);
+            hex += digits;
+        }
+        return hex;
+    }
+
+private:
+    void compress(const unsigned char *block)
+    {
+        std::uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = readBe32(block + 4 * i);
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        std::uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3], e = m_state[4];
+        for (int i = 0; i < 80; ++i) {
+            std::uint32_t f;
+            std::uint32_t k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            const std::uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+        m_state[4] += e;
+    }
+
+private:
+    std::uint32_t m_state[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+    unsigned char m_buffer[64] = {};
+    std::size_t m_buffered = 0;
+    std::uint64_t m_length = 0;
+};
+
+std::string sha1OfFile(const std::filesystem::path &path)
+{
+    const MappedFile file(path);
+    Sha1 sha1;
+    sha1.update(file.data(), file.size());
+    return sha1.finishHex();
+}
+
+// Copies length bytes between explicit offsets, in-kernel where possible so blocks reused
+// from the current file can share extents with it on filesystems that support that.
+void copyRange(int in, std::uint64_t inOffset, int out, std::uint64_t outOffset, std::uint64_t length)
+{
+    bool kernelCopy = true;
+    std::vector<unsigned char> buffer;
+    while (length > 0) {
+        if (kernelCopy) {
+            auto from = static_cast<off_t>(inOffset);
+            auto to = static_cast<off_t>(outOffset);
+            const ssize_t copied = ::copy_file_range(in, &from, out, &to, length, 0);
+            if (copied > 0) {
+                inOffset += static_cast<std::uint64_t>(copied);
+                outOffset += static_cast<std::uint64_t>(copied);
+                length -= static_cast<std::uint64_t>(copied);
+                continue;
+            }
+            if (copied == 0) {
+                throw std::runtime_error("Unexpected end of file while updating");
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != ENOSYS && errno != EXDEV && errno != EINVAL && errno != EOPNOTSUPP && errno != EBADF) {
+                throw std::runtime_error(std::string("Unable to copy data: ") + std::strerror(errno));
+            }
+            kernelCopy = false;
+            buffer.resize(kCopyBufferSize);
+        }
+
+        const std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(length, buffer.size()));
+        const ssize_t got = ::pread(in, buffer.data(), chunk, static_cast<off_t>(inOffset));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            throw std::runtime_error(got == 0 ? std::string("Unexpected end of file while updating")
+                                              : std::string("Unable to read: ") + std::strerror(errno));
+        }
+        for (ssize_t written = 0; written < got;) {
+            const ssize_t result = ::pwrite(out, buffer.data() + written, static_cast<std::size_t>(got - written),
+                static_cast<off_t>(outOffset) + written);
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            if (result < 0) {
+                throw std::runtime_error(std::string("Unable to write: ") + std::strerror(errno));
+            }
+            written += result;
+        }
+        inOffset += static_cast<std::uint64_t>(got);
+        outOffset += static_cast<std::uint64_t>(got);
+        length -= static_cast<std::uint64_t>(got);
+    }
+}
+
+std::vector<std::string> split(const std::string &value, char separator)
+{
+    std::vector<std::string> parts;
+    std::size_t start = 0;
+    while (true) {
+        const std::size_t end = value.find(separator, start);
+        parts.push_back(value.substr(start, end - start));
+        if (end == std::string::npos) {
+            return parts;
+        }
+        start = end + 1;
+    }
+}
+
+std::string trimmed(const std::string &value)
+{
+    const auto first = value.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        return {};
+    }
+    return value.substr(first, value.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+// The last path component of a URL, without query or fragment.
+std::string urlFileName(const std::string &url)
+{
+    const std::string path = url.substr(0, url.find_first_of("?#"));
+    return path.substr(path.rfind('/') + 1);
+}
+
+std::filesystem::path localPath(const std::string &source)
+{
+    constexpr const char *kFileScheme = "file://";
+    if (source.rfind(kFileScheme, 0) == 0) {
+        return source.substr(std::strlen(kFileScheme));
+    }
+    if (source.find("://") != std::string::npos) {
+        throw std::runtime_error("Only local update sources are supported: " + source);
+    }
+    return source;
+}
+
+// Name (or, for GitHub releases and Pling, a glob pattern) of the control file the update
+// information points at.
+std::string controlFileName(const std::string &updateInformation)
+{
+    const auto fields = split(updateInformation, '|');
+    if (fields[0] == "zsync" && fields.size() == 2) {
+        return urlFileName(fields[1]);
+    }
+    if ((fields[0] == "gh-releases-zsync" && fields.size() == 5) || (fields[0] == "pling-v1-zsync" && fields.size() >= 3)) {
+        return fields.back();
+    }
+    throw std::runtime_error("Unsupported update information: " + updateInformation);
+}
+
+// The newest file in directory matching pattern.
+std::filesystem::path findControlFile(const std::filesystem::path &directory, const std::string &pattern)
+{
+    std::filesystem::path found;
+    std::filesystem::file_time_type newest;
+    for (const auto &item : std::filesystem::directory_iterator(directory)) {
+        const std::string name = item.path().filename().string();
+        if (!item.is_regular_file() || ::fnmatch(pattern.c_str(), name.c_str(), 0) != 0) {
+            continue;
+        }
+        const auto modified = item.last_write_time();
+        if (found.empty() || modified > newest || (modified == newest && item.path() > found)) {
+            found = item.path();
+            newest = modified;
+        }
+    }
+    if (found.empty()) {
+        throw std::runtime_error("No update matching " + pattern + " in " + directory.string());
+    }
+    return found;
+}
+
+struct BlockSum {
+    std::uint16_t a = 0;
+    std::uint16_t b = 0;
+    Md4Digest checksum {};
+};
+
+struct ControlFile {
+    std::map<std::string, std::string> headers;
+    std::uint64_t length = 0;
+    std::size_t blockSize = 0;
+    int blockShift = 0;
+    std::size_t sequenceMatches = 1;
+    std::size_t rsumBytes = 4;
+    std::size_t checksumBytes = 16;
+    std::vector<BlockSum> blocks;
+};
+
+ControlFile readControlFile(const std::filesystem::path &path)
+{
+    const MappedFile file(path);
+    const std::string_view view = file.view();
+    const auto invalid = [&path](const std::string &reason) {
+        return std::runtime_error(path.string() + " is not a valid zsync control file: " + reason);
+    };
+    const std::size_t headerEnd = view.find("\n\n");
+    if (view.rfind("zsync:", 0) != 0 || headerEnd == std::string_view::npos) {
+        throw invalid("missing header");
+    }
+
+    ControlFile control;
+    for (const auto &line : split(std::string(view.substr(0, headerEnd)), '\n')) {
+        const std::size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            control.headers[line.substr(0, colon)] = trimmed(line.substr(colon + 1));
+        }
+    }
+    try {
+        control.length = std::stoull(control.headers.at("Length"));
+        control.blockSize = std::stoul(control.headers.at("Blocksize"));
+        if (control.headers.count("Hash-Lengths") != 0) {
+            const auto lengths = split(control.headers["Hash-Lengths"], ',');
+            if (lengths.size() != 3) {
+                throw invalid("malformed Hash-Lengths");
+            }
+            control.sequenceMatches = std::stoul(lengths[0]);
+            control.rsumBytes = std::stoul(lengths[1]);
+            control.checksumBytes = std::stoul(lengths[2]);
+        }
+    } catch (const std::logic_error &) {
+        throw invalid("missing or malformed Length or Blocksize");
+    }
+    if (control.blockSize < 64 || control.blockSize > (1u << 24) || (control.blockSize & (control.blockSize - 1)) != 0) {
+        throw invalid("block size must be a power of two");
+    }
+    if (control.sequenceMatches < 1 || control.sequenceMatches > 2 || control.rsumBytes < 1 || control.rsumBytes > 4
+        || control.checksumBytes < 3 || control.checksumBytes > 16) {
+        throw invalid("unsupported Hash-Lengths");
+    }
+    while ((std::size_t(1) << control.blockShift) < control.blockSize) {
+        ++control.blockShift;
+    }
+
+    const std::uint64_t blockCount = (control.length + control.blockSize - 1) / control.blockSize;
+    const std::size_t recordSize = control.rsumBytes + control.checksumBytes;
+    const std::size_t dataStart = headerEnd + 2;
+    if ((view.size() - dataStart) / recordSize < blockCount) {
+        throw invalid("block checksums are truncated");
+    }
+    control.blocks.resize(blockCount);
+    const unsigned char *record = file.data() + dataStart;
+    for (auto &block : control.blocks) {
+        // The stored rolling checksum is the low rsumBytes bytes of big-endian a then b.
+        unsigned char rsum[4] = {};
+        std::memcpy(rsum + 4 - control.rsumBytes, record, control.rsumBytes);
+        block.a = static_cast<std::uint16_t>(rsum[0] << 8 | rsum[1]);
+        block.b = static_cast<std::uint16_t>(rsum[2] << 8 | rsum[3]);
+        std::memcpy(block.checksum.data(), record + control.rsumBytes, control.checksumBytes);
+        record += recordSize;
+    }
+    return control;
+}
+
+// The new AppImage, where blocks missing locally are read from.
+std::filesystem::path targetFileFor(const ControlFile &control, const std::filesystem::path &controlFile)
+{
+    const std::filesystem::path directory = controlFile.parent_path();
+    const auto url = control.headers.find("URL");
+    if (url != control.headers.end() && !url->second.empty()) {
+        if (url->second.rfind("file://", 0) == 0) {
+            return localPath(url->second);
+        }
+        // A mirrored control file still names the server; expect the AppImage beside it.
+        if (url->second.find("://") != std::string::npos) {
+            return directory / urlFileName(url->second);
+        }
+        return directory / url->second;
+    }
+    const auto name = control.headers.find("Filename");
+    if (name != control.headers.end() && !name->second.empty()) {
+        return directory / std::filesystem::path(name->second).filename();
+    }
+    throw std::runtime_error(controlFile.string() + " does not name the file it describes");
+}
+
+// zsync's rolling checksum over a window of 2^shift bytes: a is the byte sum and b the
+// sum weighted by distance from the end of the window, both modulo 2^16.
+struct RollingSum {
+    std::uint16_t a = 0;
+    std::uint16_t b = 0;
+
+    void reset(const unsigned char *data, std::size_t size)
+    {
+        a = 0;
+        b = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            a = static_cast<std::uint16_t>(a + data[i]);
+            b = static_cast<std::uint16_t>(b + (size - i) * data[i]);
+        }
+    }
+
+    void roll(unsigned char out, unsigned char in, int shift)
+    {
+        a = static_cast<std::uint16_t>(a + in - out);
+        b = static_cast<std::uint16_t>(b + a - (static_cast<std::uint32_t>(out) << shift));
+    }
+};
+
+class BlockIndex {
+public:
+    using Entries = std::vector<std::pair<std::uint32_t, std::size_t>>;
+
+    explicit BlockIndex(const ControlFile &control)
+        : m_aMask(control.rsumBytes >= 4 ? 0xffff : control.rsumBytes == 3 ? 0xff : 0)
+        , m_bMask(control.rsumBytes >= 2 ? 0xffff : 0xff)
+    {
+        m_entries.reserve(control.blocks.size());
+        for (std::size_t i = 0; i < control.blocks.size(); ++i) {
+            m_entries.emplace_back(key(control.blocks[i].a, control.blocks[i].b), i);
+        }
+        std::sort(m_entries.begin(), m_entries.end());
+
+        std::size_t bits = 1u << 16;
+        while (bits < control.blocks.size() * kFilterBitsPerBlock) {
+            bits <<= 1;
+        }
+        m_filter.assign(bits, false);
+        m_filterMask = bits - 1;
+        for (const auto &entry : m_entries) {
+            m_filter[filterSlot(entry.first)] = true;
+        }
+    }
+
+    std::uint32_t key(std::uint16_t a, std::uint16_t b) const
+    {
+        return std::uint32_t(a & m_aMask) << 16 | (b & m_bMask);
+    }
+    bool mayContain(std::uint32_t key) const { return m_filter[filterSlot(key)]; }
+
+    // Blocks with the given key, in block order.
+    std::pair<Entries::const_iterator, Entries::const_iterator> blocksWith(std::uint32_t key) const
+    {
+        return std::equal_range(m_entries.begin(), m_entries.end(), std::make_pair(key, std::size_t(0)),
+            [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+    }
+
+private:
+    std::size_t filterSlot(std::uint32_t key) const { return (key * 0x9e3779b1u) & m_filterMask; }
+
+private:
+    std::uint16_t m_aMask;
+    std::uint16_t m_bMask;
+    Entries m_entries;
+    std::vector<bool> m_filter;
+    std::size_t m_filterMask = 0;
+};
+
+constexpr std::uint64_t kNotFound = ~std::uint64_t(0);
+
+// For each target block, an offset in current holding the same bytes, or kNotFound.
+std::vector<std::uint64_t> matchBlocks(const ControlFile &control, const MappedFile &current)
+{
+    std::vector<std::uint64_t> sources(control.blocks.size(), kNotFound);
+    const std::size_t blockSize = control.blockSize;
+    const unsigned char *data = current.data();
+    const std::size_t size = current.size();
+    if (size < blockSize || control.blocks.empty()) {
+        return sources;
+    }
+
+    const BlockIndex index(control);
+    const auto strongMatch = [&](std::size_t block, const Md4Digest &digest) {
+        return std::memcmp(digest.data(), control.blocks[block].checksum.data(), control.checksumBytes) == 0;
+    };
+    // With sequence matches, a block only counts when the block after it matches too, as
+    // the per-block checksums are then too short to trust alone.
+    const auto nextBlockMatches = [&](std::size_t block, std::size_t offset) {
+        if (control.sequenceMatches < 2 || block + 2 >= control.blocks.size()) {
+            return true;
+        }
+        if (offset + 2 * blockSize > size) {
+            return false;
+        }
+        RollingSum next;
+        next.reset(data + offset + blockSize, blockSize);
+        return index.key(next.a, next.b) == index.key(control.blocks[block + 1].a, control.blocks[block + 1].b)
+            && strongMatch(block + 1, md4(data + offset + blockSize, blockSize));
+    };
+
+    RollingSum sum;
+    sum.reset(data, blockSize);
+    std::size_t offset = 0;
+    while (true) {
+        bool matched = false;
+        const std::uint32_t key = index.key(sum.a, sum.b);
+        if (index.mayContain(key)) {
+            Md4Digest digest {};
+            bool hashed = false;
+            const auto range = index.blocksWith(key);
+            for (auto entry = range.first; entry != range.second; ++entry) {
+                const std::size_t block = entry->second;
+                if (sources[block] != kNotFound) {
+                    continue;
+                }
+                if (!hashed) {
+                    digest = md4(data + offset, blockSize);
+                    hashed = true;
+                }
+                if (strongMatch(block, digest) && nextBlockMatches(block, offset)) {
+                    sources[block] = offset;
+                    matched = true;
+                }
+            }
+        }
+
+        if (matched) {
+            // zsync does the same: skip past a match instead of rolling through it.
+            if (offset + 2 * blockSize > size) {
+                break;
+            }
+            offset += blockSize;
+            sum.reset(data + offset, blockSize);
+            continue;
+        }
+        if (offset + blockSize >= size) {
+            break;
+        }
+        sum.roll(data[offset], data[offset + blockSize], control.blockShift);
+        ++offset;
+    }
+    return sources;
+}
+
+// Removes the output unless released, so failures leave nothing behind.
+class OutputGuard {
+public:
+    explicit OutputGuard(std::filesystem::path path)
+        : m_path(std::move(path))
+    {
+    }
+    ~OutputGuard()
+    {
+        if (!m_path.empty()) {
+            ::unlink(m_path.c_str());
+        }
+    }
+    OutputGuard(const OutputGuard &) = delete;
+    OutputGuard &operator=(const OutputGuard &) = delete;
+
+    void release() { m_path.clear(); }
+
+private:
+    std::filesystem::path m_path;
+};
+
+} // namespace
+
+std::optional<std::string> readUpdateInformation(const std::filesystem::path &appImage)
+{
+    const MappedFile file(appImage);
+    const unsigned char *data = file.data();
+    const std::size_t size = file.size();
+    if (size < 64 || std::memcmp(data, "\x7f" "ELF", 4) != 0 || (data[4] != 1 && data[4] != 2)
+        || (data[5] != 1 && data[5] != 2)) {
+        throw std::runtime_error(appImage.string() + " is not an ELF executable");
+    }
+    const bool is64 = data[4] == 2;
+    const bool bigEndian = data[5] == 2;
+    const std::uint64_t tableOffset = readElf(data + (is64 ? 0x28 : 0x20), is64 ? 8 : 4, bigEndian);
+    const std::uint64_t entrySize = readElf(data + (is64 ? 0x3a : 0x2e), 2, bigEndian);
+    const std::uint64_t count = readElf(data + (is64 ? 0x3c : 0x30), 2, bigEndian);
+    const std::uint64_t namesIndex = readElf(data + (is64 ? 0x3e : 0x32), 2, bigEndian);
+    if (entrySize < (is64 ? 0x28u : 0x18u) || tableOffset > size || count > (size - tableOffset) / entrySize
+        || namesIndex >= count) {
+        return std::nullopt;
+    }
+
+    // (offset, size) of section i.
+    const auto section = [&](std::uint64_t i) {
+        const unsigned char *header = data + tableOffset + i * entrySize;
+        return std::make_pair(readElf(header + (is64 ? 0x18 : 0x10), is64 ? 8 : 4, bigEndian),
+            readElf(header + (is64 ? 0x20 : 0x14), is64 ? 8 : 4, bigEndian));
+    };
+    const auto names = section(namesIndex);
+    if (names.first > size || names.second > size - names.first) {
+        return std::nullopt;
+    }
+    const std::string_view nameTable(reinterpret_cast<const char *>(data + names.first), names.second);
+    for (std::uint64_t i = 0; i < count; ++i) {
+        const std::uint64_t nameOffset = readElf(data + tableOffset + i * entrySize, 4, bigEndian);
+        if (nameOffset >= nameTable.size()) {
+            continue;
+        }
+        const std::string_view name = nameTable.substr(nameOffset);
+        if (name.substr(0, name.find('\0')) != ".upd_info") {
+            continue;
+        }
+        const auto contents = section(i);
+        if (contents.first > size || contents.second > size - contents.first) {
+            return std::nullopt;
+        }
+        const std::string_view value(reinterpret_cast<const char *>(data + contents.first), contents.second);
+        std::string information = trimmed(std::string(value.substr(0, value.find('\0'))));
+        if (information.empty()) {
+            return std::nullopt;
+        }
+        return information;
+    }
+    return std::nullopt;
+}
+
+DeltaUpdateResult buildDeltaUpdate(const std::filesystem::path &current, const std::string &updateInformation,
+    const std::string &source, const std::filesystem::path &output)
+{
+    DeltaUpdateResult result;
+    const std::filesystem::path sourcePath = localPath(source);
+    if (std::filesystem::is_directory(sourcePath)) {
+        if (updateInformation.empty()) {
+            throw std::runtime_error(current.string() + " has no update information; pass its .zsync file instead");
+        }
+        result.controlFile = findControlFile(sourcePath, controlFileName(updateInformation));
+    } else {
+        result.controlFile = sourcePath;
+    }
+
+    const ControlFile control = readControlFile(result.controlFile);
+    result.targetFile = targetFileFor(control, result.controlFile);
+    result.targetSize = control.length;
+    const auto sha1 = control.headers.find("SHA-1");
+    const std::string expectedSha1 = sha1 == control.headers.end() ? std::string() : sha1->second;
+
+    const MappedFile currentFile(current);
+    // Decided by the whole-file hash alone: matchBlocks() maps identical blocks, such as runs
+    // of zero padding, to the first place their content occurs rather than to their own.
+    if (currentFile.size() == control.length && !expectedSha1.empty() && sha1OfFile(current) == expectedSha1) {
+        result.upToDate = true;
+        return result;
+    }
+
+    const std::vector<std::uint64_t> sources = matchBlocks(control, currentFile);
+    const std::size_t blockSize = control.blockSize;
+    const std::size_t blockCount = control.blocks.size();
+
+    const FileDescriptor currentFd(::open(current.c_str(), O_RDONLY | O_CLOEXEC));
+    if (currentFd.get() < 0) {
+        throw ioError("Unable to open", current);
+    }
+    const FileDescriptor out(::open(output.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600));
+    if (out.get() < 0) {
+        throw ioError("Unable to create", output);
+    }
+    OutputGuard guard(output);
+
+    // Opened only once a block is missing locally, so an update that reuses everything
+    // does not need the new AppImage at all.
+    std::optional<FileDescriptor> target;
+    const auto targetFd = [&]() {
+        if (!target) {
+            target.emplace(::open(result.targetFile.c_str(), O_RDONLY | O_CLOEXEC));
+            if (target->get() < 0) {
+                throw ioError("Unable to open", result.targetFile);
+            }
+        }
+        return target->get();
+    };
+
+    // Runs of consecutive blocks come from one place, so each is a single copy.
+    for (std::size_t i = 0; i < blockCount;) {
+        std::size_t end = i + 1;
+        if (sources[i] != kNotFound) {
+            while (end < blockCount && sources[end] == sources[end - 1] + blockSize) {
+                ++end;
+            }
+        } else {
+            while (end < blockCount && sources[end] == kNotFound) {
+                ++end;
+            }
+        }
+        const std::uint64_t start = std::uint64_t(i) * blockSize;
+        const std::uint64_t length = std::min<std::uint64_t>(std::uint64_t(end) * blockSize, control.length) - start;
+        if (sources[i] != kNotFound) {
+            copyRange(currentFd.get(), sources[i], out.get(), start, length);
+            result.reusedBytes += length;
+        } else {
+            copyRange(targetFd(), start, out.get(), start, length);
+            result.fetchedBytes += length;
+        }
+        i = end;
+    }
+
+    // Short checksums can let a wrong block through; the whole-file hash catches that, and
+    // the new AppImage is then read in full instead.
+    if (!expectedSha1.empty() && sha1OfFile(output) != expectedSha1 && result.reusedBytes > 0) {
+        if (::ftruncate(out.get(), 0) != 0) {
+            throw ioError("Unable to truncate", output);
+        }
+        copyRange(targetFd(), 0, out.get(), 0, control.length);
+        result.reusedBytes = 0;
+        result.fetchedBytes = control.length;
+    }
+    if (!expectedSha1.empty() && sha1OfFile(output) != expectedSha1) {
+        throw std::runtime_error(result.targetFile.string() + " does not match the SHA-1 in " + result.controlFile.string());
+    }
+
+    struct stat info {};
+    if (::fstat(currentFd.get(), &info) != 0 || ::fchmod(out.get(), info.st_mode & 07777) != 0) {
+        throw ioError("Unable to set permissions of", output);
+    }
+    if (::fsync(out.get()) != 0) {
+        throw ioError("Unable to sync", output);
+    }
+    guard.release();
+    return result;
+}
+
+} // namespace appimagelauncher
@@ -0,0 +1,138 @@
+#include "AppImageManager/IconCache.h"
+
+#include "AppImageManager/FunctionTask.h"
+#include "AppImageManager/SquashFsReader.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QPixmap>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <utility>
+
+namespace appimagelauncher {
+
+namespace {
+constexpr int kIconSize = 128;
+
+QString cacheKey(const QFileInfo &info)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(info.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    return QString::fromLatin1(hash.result().toHex());
+}
+
+// Reads .DirIcon straight out of the SquashFS payload; the reader follows it when it is a
+// symlink to the real icon file. Type 1 (ISO 9660) and unreadable AppImages have no icon.
+QImage readDirIcon(const QString &appImagePath)
+{
+    try {
+        const SquashFsReader reader(QFile::encodeName(appImagePath).toStdString());
+        const auto data = reader.readFile(".DirIcon");
+        if (!data) {
+            return {};
+        }
+        return QImage::fromData(reinterpret_cast<const uchar *>(data->data()), static_cast<int>(data->size()));
+    } catch (const std::exception &) {
+        return {};
+    }
+}
+
+} // namespace
+
+IconCache::IconCache(QObject *parent)
+    : QObject(parent)
+    , m_cacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/icons"))
+{
+    QDir().mkpath(m_cacheDirectory);
+    m_pool.setMaxThreadCount(std::max(1, std::min(4, QThread::idealThreadCount())));
+}
+
+IconCache::~IconCache()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+QIcon IconCache::icon(const AppImageEntry &entry)
+{
+    const QString path = QString::fromStdString(entry.storedPath.string());
+    const QString contentHash = QString::fromStdString(entry.contentHash);
+    const auto it = m_icons.constFind(path);
+    if (it != m_icons.constEnd() && it->contentHash == contentHash) {
+        return it->icon;
+    }
+    const auto missing = m_missing.constFind(path);
+    if (missing != m_missing.constEnd() && missing.value() == contentHash) {
+        return {};
+    }
+    // The previous build's icon, if any, stays up until the new one has been read.
+    const QIcon previous = it != m_icons.constEnd() ? it->icon : QIcon();
+    const QString pendingKey = path + QLatin1Char('\n') + contentHash;
+    if (m_pending.contains(pendingKey)) {
+        return previous;
+    }
+
+    m_pending.insert(pendingKey);
+    const QString id = QString::fromStdString(entry.id);
+    const QString cacheDirectory = m_cacheDirectory;
+    m_pool.start(new FunctionTask([this, id, path, contentHash, cacheDirectory]() {
+        QImage image;
+        const QFileInfo info(path);
+        if (info.exists()) {
+            const QString key = cacheKey(info);
+            const QString cachedPath = cacheDirectory + QLatin1Char('/') + key + QStringLiteral(".png");
+            const QString missingPath = cacheDirectory + QLatin1Char('/') + key + QStringLiteral(".none");
+            if (QFile::exists(cachedPath)) {
+                image.load(cachedPath);
+            } else if (!QFile::exists(missingPath)) {
+                image = readDirIcon(path);
+                if (!image.isNull()) {
+                    if (image.width() > kIconSize || image.height() > kIconSize) {
+                        image = image.scaled(kIconSize, kIconSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+                    }
+                    QSaveFile file(cachedPath);
+                    if (file.open(QIODevice::WriteOnly) && image.save(&file, "PNG")) {
+                        file.commit();
+                    }
+                } else {
+                    // Remember AppImages without an icon so they are not probed on every start.
+                    QFile marker(missingPath);
+                    marker.open(QIODevice::WriteOnly);
+                }
+            }
+        }
+
+        QMetaObject::invokeMethod(
+            this, [this, id, path, contentHash, image]() { onExtracted(id, path, contentHash, image); }, Qt::QueuedConnection);
+    }));
+    return previous;
+}
+
+void IconCache::onExtracted(const QString &id, const QString &path, const QString &contentHash, const QImage &image)
+{
+    m_pending.remove(path + QLatin1Char('\n') + contentHash);
+    // Replaces whatever was kept for an earlier build at the same path.
+    m_icons.remove(path);
+    m_missing.remove(path);
+    if (image.isNull()) {
+        m_missing.insert(path, contentHash);
+    } else {
+        m_icons.insert(path, { contentHash, QIcon(QPixmap::fromImage(image)) });
+    }
+    // Also sent without an icon, so a row that showed the previous build's icon drops it.
+    emit iconReady(id);
+}
+
+} // namespace appimagelauncher
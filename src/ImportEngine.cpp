@@ -0,0 +1,414 @@
+#include "AppImageManager/ImportEngine.h"
+
+#include "AppImageManager/FileDescriptor.h"
+#include "AppImageManager/MappedFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace appimagelauncher {
+
+namespace {
+
+// Collisions are retried with the next candidate; the bound only stops a runaway loop.
+constexpr unsigned kMaxPlacementAttempts = 10000;
+
+// Large enough that per-call overhead vanishes, small enough for smooth progress.
+constexpr std::size_t kChunkSize = 8u << 20;
+constexpr std::size_t kBufferSize = 1u << 20;
+// Runs of identical data are looked for in granules of this size and submitted in pieces
+// no longer than the largest range Btrfs and XFS dedupe in one call.
+constexpr std::size_t kDedupeGranule = 64u << 10;
+constexpr std::size_t kMaxDedupeLength = 16u << 20;
+
+// Errors meaning "this kernel or filesystem pair cannot do it", as opposed to I/O errors.
+bool unsupported(int error)
+{
+    return error == ENOSYS || error == EXDEV || error == EINVAL || error == EOPNOTSUPP || error == ENOTTY
+        || error == EBADF || error == EPERM;
+}
+
+void reportProgress(const ImportProgress &progress, std::uint64_t copied, std::uint64_t total)
+{
+    if (progress && !progress(copied, total)) {
+        throw ImportCancelled();
+    }
+}
+
+// Each stage continues from the current file offsets, so a later one can take over
+// part-way through. Returns false when the stage is unsupported for this pair of files.
+bool copyWithCopyFileRange(int in, int out, std::uint64_t total, std::uint64_t &copied, const ImportProgress &progress,
+    const std::filesystem::path &source)
+{
+    while (copied < total) {
+        const auto request = static_cast<std::size_t>(std::min<std::uint64_t>(kChunkSize, total - copied));
+        const ssize_t result = ::copy_file_range(in, nullptr, out, nullptr, request, 0);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (unsupported(errno)) {
+                return false;
+            }
+            throw ioError("Unable to copy", source);
+        }
+        if (result == 0) {
+            break;
+        }
+        copied += static_cast<std::uint64_t>(result);
+        reportProgress(progress, copied, total);
+    }
+    return true;
+}
+
+bool copyWithSendfile(int in, int out, std::uint64_t total, std::uint64_t &copied, const ImportProgress &progress,
+    const std::filesystem::path &source)
+{
+    while (copied < total) {
+        const auto request = static_cast<std::size_t>(std::min<std::uint64_t>(kChunkSize, total - copied));
+        const ssize_t result = ::sendfile(out, in, nullptr, request);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (unsupported(errno)) {
+                return false;
+            }
+            throw ioError("Unable to copy", source);
+        }
+        if (result == 0) {
+            break;
+        }
+        copied += static_cast<std::uint64_t>(result);
+        reportProgress(progress, copied, total);
+    }
+    return true;
+}
+
+void copyWithBuffer(int in, int out, std::uint64_t total, std::uint64_t &copied, const ImportProgress &progress,
+    const std::filesystem::path &source, const std::filesystem::path &destination)
+{
+    ::posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+    std::vector<char> buffer(kBufferSize);
+    std::uint64_t sinceReport = 0;
+    while (true) {
+        const ssize_t readBytes = ::read(in, buffer.data(), buffer.size());
+        if (readBytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw ioError("Unable to read", source);
+        }
+        if (readBytes == 0) {
+            break;
+        }
+
+        const char *data = buffer.data();
+        std::size_t remaining = static_cast<std::size_t>(readBytes);
+        while (remaining > 0) {
+            const ssize_t written = ::write(out, data, remaining);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw ioError("Unable to write", destination);
+            }
+            data += written;
+            remaining -= static_cast<std::size_t>(written);
+        }
+
+        copied += static_cast<std::uint64_t>(readBytes);
+        sinceReport += static_cast<std::uint64_t>(readBytes);
+        if (sinceReport >= kChunkSize) {
+            sinceReport = 0;
+            reportProgress(progress, copied, std::max(total, copied));
+        }
+    }
+    reportProgress(progress, copied, std::max(total, copied));
+}
+
+void syncDirectory(const std::filesystem::path &directory)
+{
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+enum class Placement {
+    Placed,
+    Exists,
+    CrossDevice
+};
+
+// Moves from to to, never replacing a file that is already there, so concurrent imports
+// (from this or another process) cannot overwrite each other.
+Placement placeWithoutReplacing(const std::filesystem::path &from, const std::filesystem::path &to)
+{
+    if (::renameat2(AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), RENAME_NOREPLACE) == 0) {
+        return Placement::Placed;
+    }
+    if (errno == EEXIST) {
+        return Placement::Exists;
+    }
+    if (errno == EXDEV) {
+        return Placement::CrossDevice;
+    }
+    if (errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP) {
+        throw ioError("Unable to move", from);
+    }
+
+    // Filesystems without RENAME_NOREPLACE: link() does not replace either.
+    if (::link(from.c_str(), to.c_str()) == 0) {
+        ::unlink(from.c_str());
+        return Placement::Placed;
+    }
+    if (errno == EEXIST) {
+        return Placement::Exists;
+    }
+    if (errno == EXDEV) {
+        return Placement::CrossDevice;
+    }
+    if (errno != EPERM && errno != EOPNOTSUPP) {
+        throw ioError("Unable to move", from);
+    }
+
+    // Nor hardlinks (e.g. FAT): the best remaining option is check-then-rename.
+    if (::access(to.c_str(), F_OK) == 0) {
+        return Placement::Exists;
+    }
+    if (::rename(from.c_str(), to.c_str()) != 0) {
+        throw ioError("Unable to move", from);
+    }
+    return Placement::Placed;
+}
+
+// Places from at the first free candidate from attempt onwards, leaving attempt at the
+// candidate tried last. Returns an empty path when the move would cross filesystems.
+std::filesystem::path placeAtFirstFree(
+    const std::filesystem::path &from, const DestinationCandidates &candidates, unsigned &attempt)
+{
+    for (; attempt < kMaxPlacementAttempts; ++attempt) {
+        std::filesystem::path destination = candidates(attempt);
+        if (destination.empty()) {
+            break;
+        }
+        switch (placeWithoutReplacing(from, destination)) {
+        case Placement::Placed:
+            return destination;
+        case Placement::Exists:
+            continue;
+        case Placement::CrossDevice:
+            return {};
+        }
+    }
+    throw std::runtime_error("No free destination for " + from.string());
+}
+
+} // namespace
+
+ImportResult copyForImport(const std::filesystem::path &source, const std::filesystem::path &destination,
+    const ImportProgress &progress)
+{
+    FileDescriptor in(::open(source.c_str(), O_RDONLY | O_CLOEXEC));
+    if (in.get() < 0) {
+        throw ioError("Unable to open", source);
+    }
+    struct stat info {};
+    if (::fstat(in.get(), &info) != 0) {
+        throw ioError("Unable to stat", source);
+    }
+    if (!S_ISREG(info.st_mode)) {
+        throw std::runtime_error("Not a regular file: " + source.string());
+    }
+
+    FileDescriptor out(::open(destination.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, info.st_mode & 07777));
+    if (out.get() < 0) {
+        throw ioError("Unable to create", destination);
+    }
+
+    const auto total = static_cast<std::uint64_t>(info.st_size);
+    ImportResult result;
+    result.bytes = total;
+    result.destination = destination;
+    try {
+        std::uint64_t copied = 0;
+        if (::ioctl(out.get(), FICLONE, in.get()) == 0) {
+            result.method = ImportMethod::Reflink;
+            copied = total;
+            reportProgress(progress, copied, total);
+        } else if (copyWithCopyFileRange(in.get(), out.get(), total, copied, progress, source)) {
+            result.method = ImportMethod::CopyFileRange;
+        } else if (copyWithSendfile(in.get(), out.get(), total, copied, progress, source)) {
+            result.method = ImportMethod::Sendfile;
+        } else {
+            result.method = ImportMethod::BufferedCopy;
+            copyWithBuffer(in.get(), out.get(), total, copied, progress, source, destination);
+        }
+
+        // The mode passed to open() is filtered by the umask; AppImages must stay executable.
+        if (::fchmod(out.get(), info.st_mode & 07777) != 0) {
+            throw ioError("Unable to set permissions on", destination);
+        }
+        if (::fsync(out.get()) != 0) {
+            throw ioError("Unable to sync", destination);
+        }
+        struct stat written {};
+        if (::fstat(out.get(), &written) != 0) {
+            throw ioError("Unable to stat", destination);
+        }
+        if (static_cast<std::uint64_t>(written.st_size) != total || copied != total) {
+            throw std::runtime_error("Size mismatch after copying " + source.string() + " to " + destination.string());
+        }
+        if (::close(out.release()) != 0) {
+            throw ioError("Unable to close", destination);
+        }
+    } catch (...) {
+        const int fd = out.release();
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        ::unlink(destination.c_str());
+        throw;
+    }
+    return result;
+}
+
+ImportResult moveForImport(const std::filesystem::path &source, const DestinationCandidates &candidates,
+    const ImportProgress &progress)
+{
+    std::error_code error;
+    const std::uint64_t size = std::filesystem::file_size(source, error);
+    reportProgress(progress, 0, size);
+
+    unsigned attempt = 0;
+    std::filesystem::path destination = placeAtFirstFree(source, candidates, attempt);
+    if (!destination.empty()) {
+        // Too late to cancel: the file has already moved.
+        if (progress) {
+            progress(size, size);
+        }
+        return ImportResult { ImportMethod::Rename, size, destination };
+    }
+
+    // Copy next to the destination under a private name, then place it like a rename so a
+    // partial copy never shows up under a real name.
+    const std::filesystem::path candidate = candidates(attempt);
+    const std::filesystem::path temporary = candidate.parent_path()
+        / ("." + candidate.filename().string() + "." + std::to_string(::getpid()) + ".part");
+    ::unlink(temporary.c_str());
+    ImportResult result = copyForImport(source, temporary, progress);
+    try {
+        result.destination = placeAtFirstFree(temporary, candidates, attempt);
+        if (result.destination.empty()) {
+            throw std::runtime_error("Unexpected cross-device move of " + temporary.string());
+        }
+    } catch (...) {
+        ::unlink(temporary.c_str());
+        throw;
+    }
+
+    syncDirectory(result.destination.parent_path());
+    if (::unlink(source.c_str()) != 0) {
+        throw ioError("Copied AppImage but unable to remove", source);
+    }
+    return result;
+}
+
+ImportResult moveForImport(const std::filesystem::path &source, const std::filesystem::path &destination,
+    const ImportProgress &progress)
+{
+    return moveForImport(
+        source, [&destination](unsigned attempt) { return attempt == 0 ? destination : std::filesystem::path(); },
+        progress);
+}
+
+std::uint64_t shareIdenticalBlocks(const std::filesystem::path &reference, const std::filesystem::path &copy)
+{
+    FileDescriptor in(::open(reference.c_str(), O_RDONLY | O_CLOEXEC));
+    if (in.get() < 0) {
+        throw ioError("Unable to open", reference);
+    }
+    FileDescriptor out(::open(copy.c_str(), O_RDWR | O_CLOEXEC));
+    if (out.get() < 0) {
+        throw ioError("Unable to open", copy);
+    }
+    struct stat referenceInfo {};
+    struct stat copyInfo {};
+    if (::fstat(in.get(), &referenceInfo) != 0 || ::fstat(out.get(), &copyInfo) != 0) {
+        throw ioError("Unable to stat", copy);
+    }
+    if (referenceInfo.st_dev != copyInfo.st_dev || referenceInfo.st_ino == copyInfo.st_ino) {
+        return 0;
+    }
+
+    const MappedFile referenceData(reference);
+    const MappedFile copyData(copy);
+    const std::size_t size = std::min(referenceData.size(), copyData.size());
+    const auto same = [&](std::size_t offset) {
+        return std::memcmp(referenceData.data() + offset, copyData.data() + offset, kDedupeGranule) == 0;
+    };
+
+    std::uint64_t shared = 0;
+    alignas(file_dedupe_range) unsigned char request[sizeof(file_dedupe_range) + sizeof(file_dedupe_range_info)];
+    auto *range = reinterpret_cast<file_dedupe_range *>(request);
+    for (std::size_t offset = 0; offset + kDedupeGranule <= size;) {
+        if (!same(offset)) {
+            offset += kDedupeGranule;
+            continue;
+        }
+        std::size_t end = offset + kDedupeGranule;
+        while (end + kDedupeGranule <= size && end - offset < kMaxDedupeLength && same(end)) {
+            end += kDedupeGranule;
+        }
+
+        std::memset(request, 0, sizeof(request));
+        range->src_offset = offset;
+        range->src_length = end - offset;
+        range->dest_count = 1;
+        range->info[0].dest_fd = out.get();
+        range->info[0].dest_offset = offset;
+        if (::ioctl(in.get(), FIDEDUPERANGE, range) != 0) {
+            if (unsupported(errno)) {
+                return shared;
+            }
+            throw ioError("Unable to share blocks with", copy);
+        }
+        if (range->info[0].status == FILE_DEDUPE_RANGE_SAME) {
+            shared += range->info[0].bytes_deduped;
+        }
+        offset = end;
+    }
+    return shared;
+}
+
+const char *importMethodName(ImportMethod method)
+{
+    switch (method) {
+    case ImportMethod::Rename:
+        return "rename";
+    case ImportMethod::Reflink:
+        return "reflink";
+    case ImportMethod::CopyFileRange:
+        return "copy_file_range";
+    case ImportMethod::Sendfile:
+        return "sendfile";
+    case ImportMethod::BufferedCopy:
+        return "buffered copy";
+    }
+    return "unknown";
+}
+
+} // namespace appimagelauncher
@@ -0,0 +1,129 @@
+#include "AppImageManager/ImportQueue.h"
+
+#include "AppImageManager/FunctionTask.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+#include <atomic>
+#include <exception>
+
+namespace appimagelauncher {
+
+struct ImportQueue::Job {
+    quint64 id = 0;
+    QString fileName;
+    AppImageManager::PreparedImport import;
+    std::atomic_bool cancelled { false };
+    // Written by the worker before it posts onJobDone().
+    bool copied = false;
+    QString error;
+};
+
+ImportQueue::ImportQueue(AppImageManager &manager, QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_nextJob(1)
+{
+    // A single worker keeps jobs in order and avoids several large copies competing for
+    // the same disks.
+    m_pool.setMaxThreadCount(1);
+}
+
+ImportQueue::~ImportQueue()
+{
+    for (const auto &job : std::as_const(m_jobs)) {
+        job->cancelled = true;
+    }
+    m_pool.waitForDone();
+
+    // onJobDone() will never run for these; register what was already moved into storage
+    // so no file is left behind untracked.
+    for (const auto &job : std::as_const(m_jobs)) {
+        if (job->copied) {
+            try {
+                registerJob(*job);
+            } catch (const std::exception &) {
+                // The file stays in storage; nothing else can be done during teardown.
+            }
+        }
+    }
+}
+
+quint64 ImportQueue::enqueue(const QString &path, bool moveToStorage)
+{
+    auto job = std::make_shared<Job>();
+    job->id = m_nextJob++;
+    job->fileName = QFileInfo(path).fileName();
+    job->import = m_manager.prepareImport(QFile::encodeName(path).toStdString(), moveToStorage);
+    m_jobs.insert(job->id, job);
+    emit jobQueued(job->id, job->fileName);
+
+    m_pool.start(new FunctionTask([this, job]() {
+        if (!job->cancelled) {
+            int reportedPermille = -1;
+            const ImportProgress progress = [this, &job, &reportedPermille](std::uint64_t copied, std::uint64_t total) {
+                if (job->cancelled) {
+                    return false;
+                }
+                const int permille = total == 0 ? 1000 : static_cast<int>(copied * 1000 / total);
+                if (permille != reportedPermille) {
+                    reportedPermille = permille;
+                    emit jobProgress(job->id, static_cast<qint64>(copied), static_cast<qint64>(total));
+                }
+                return true;
+            };
+            try {
+                AppImageManager::performImport(job->import, progress);
+                job->copied = true;
+            } catch (const ImportCancelled &) {
+                // The engine already removed the partial copy.
+            } catch (const std::exception &error) {
+                job->error = QString::fromUtf8(error.what());
+            }
+        }
+
+        const quint64 id = job->id;
+        QMetaObject::invokeMethod(this, [this, id]() { onJobDone(id); }, Qt::QueuedConnection);
+    }));
+    return job->id;
+}
+
+void ImportQueue::cancel(quint64 job)
+{
+    const auto it = m_jobs.constFind(job);
+    if (it != m_jobs.constEnd()) {
+        it.value()->cancelled = true;
+    }
+}
+
+void ImportQueue::onJobDone(quint64 id)
+{
+    const auto job = m_jobs.take(id);
+    if (!job) {
+        return;
+    }
+
+    if (!job->copied) {
+        if (job->error.isEmpty()) {
+            emit jobCancelled(id);
+        } else {
+            emit jobFailed(id, job->fileName, job->error);
+        }
+        return;
+    }
+
+    try {
+        const AppImageEntry entry = registerJob(*job);
+        emit jobFinished(id, QString::fromStdString(entry.id));
+    } catch (const std::exception &error) {
+        emit jobFailed(id, job->fileName, QString::fromUtf8(error.what()));
+    }
+}
+
+AppImageEntry ImportQueue::registerJob(Job &job)
+{
+    return m_manager.finishImport(job.import);
+}
+
+} // namespace appimagelauncher
@@ -0,0 +1,141 @@
+#include "AppImageManager/InboxWatcher.h"
+
+#include "AppImageManager/AppImageValidator.h"
+
+#include <QDir>
+#include <QFile>
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace appimagelauncher {
+
+namespace {
+
+// Long enough to gather downloads finishing together, short enough to feel immediate.
+constexpr int kBatchMilliseconds = 1000;
+
+} // namespace
+
+InboxWatcher::InboxWatcher(QObject *parent)
+    : QObject(parent)
+    , m_inotifyFd(-1)
+    , m_notifier(nullptr)
+{
+    m_batchTimer.setSingleShot(true);
+    m_batchTimer.setInterval(kBatchMilliseconds);
+    connect(&m_batchTimer, &QTimer::timeout, this, &InboxWatcher::flush);
+}
+
+InboxWatcher::~InboxWatcher()
+{
+    stop();
+}
+
+void InboxWatcher::setDirectory(const QString &directory)
+{
+    if (directory == m_directory && (directory.isEmpty() || m_inotifyFd >= 0)) {
+        return;
+    }
+    stop();
+    if (directory.isEmpty()) {
+        return;
+    }
+
+    const int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Unable to initialise inotify: ") + std::strerror(errno));
+    }
+    const QByteArray encoded = QFile::encodeName(directory);
+    if (::inotify_add_watch(fd, encoded.constData(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) < 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Unable to watch " + encoded.toStdString() + ": " + std::strerror(error));
+    }
+
+    m_directory = directory;
+    m_inotifyFd = fd;
+    m_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &InboxWatcher::onReadable);
+}
+
+void InboxWatcher::stop()
+{
+    m_batchTimer.stop();
+    m_pending.clear();
+    if (m_notifier) {
+        // May run from the notifier's own activated() signal.
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = nullptr;
+    }
+    if (m_inotifyFd >= 0) {
+        ::close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+    m_directory.clear();
+}
+
+void InboxWatcher::onReadable()
+{
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        const ssize_t length = ::read(m_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            if (length < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            if (event->mask & IN_IGNORED) {
+                // The directory was deleted or unmounted; the watch is gone.
+                stop();
+                return;
+            }
+            if (event->len == 0 || (event->mask & IN_ISDIR)) {
+                continue;
+            }
+            const QString name = QFile::decodeName(event->name);
+            if (!name.endsWith(QStringLiteral(".AppImage"), Qt::CaseInsensitive)) {
+                continue;
+            }
+            const QString path = QDir(m_directory).filePath(name);
+            if (!m_pending.contains(path)) {
+                m_pending << path;
+            }
+            m_batchTimer.start();
+        }
+    }
+}
+
+// Checked at the end of the window rather than per event, so files renamed or deleted
+// right after arriving are dropped.
+void InboxWatcher::flush()
+{
+    QStringList arrived;
+    for (const QString &path : std::as_const(m_pending)) {
+        try {
+            validateAppImage(QFile::encodeName(path).toStdString());
+            arrived << path;
+        } catch (const std::exception &) {
+            // Not an AppImage, incomplete, or already gone.
+        }
+    }
+    m_pending.clear();
+    if (!arrived.isEmpty()) {
+        emit appImagesArrived(arrived);
+    }
+}
+
+} // namespace appimagelauncher
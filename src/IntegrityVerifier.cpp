@@ -0,0 +1,121 @@
+#include "AppImageManager/IntegrityVerifier.h"
+
+#include "AppImageManager/AppImageValidator.h"
+#include "AppImageManager/ContentHash.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <optional>
+#include <utility>
+
+#include <sys/stat.h>
+
+namespace appimagelauncher {
+
+namespace {
+
+// Reads a few hundred bytes, so junk is rejected without hashing it. Entries that recorded
+// their format on import must still have the same one.
+std::optional<std::string> formatProblem(const AppImageEntry &entry)
+{
+    try {
+        const AppImageFormat format = validateAppImage(entry.storedPath);
+        if (entry.appImageType != 0
+            && (format.type != entry.appImageType || format.machine != entry.machine
+                || format.payloadOffset != entry.payloadOffset)) {
+            return std::string("format differs from the one recorded on import");
+        }
+    } catch (const std::exception &error) {
+        return std::string(error.what());
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+std::size_t VerifyReport::failureCount() const
+{
+    return static_cast<std::size_t>(std::count_if(results.begin(), results.end(), [](const VerifyResult &result) {
+        return result.status == VerifyStatus::Mismatch || result.status == VerifyStatus::Missing
+            || result.status == VerifyStatus::Unreadable || result.status == VerifyStatus::Invalid;
+    }));
+}
+
+double VerifyReport::gigabytesPerSecond() const
+{
+    return seconds > 0.0 ? static_cast<double>(bytesHashed) / seconds / 1e9 : 0.0;
+}
+
+VerifyReport verifyEntries(const std::vector<AppImageEntry> &entries, const VerifyProgress &progress)
+{
+    VerifyReport report;
+    report.results.reserve(entries.size());
+    // (device, inode) -> hash, so storage shared by hardlinked duplicates is read once.
+    std::map<std::pair<dev_t, ino_t>, std::string> hashedInodes;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t index = 0; index < entries.size(); ++index) {
+        const AppImageEntry &entry = entries[index];
+        VerifyResult result;
+        result.id = entry.id;
+        result.storedPath = entry.storedPath;
+
+        struct stat info {};
+        if (::stat(entry.storedPath.c_str(), &info) != 0) {
+            result.status = errno == ENOENT ? VerifyStatus::Missing : VerifyStatus::Unreadable;
+            result.error = std::strerror(errno);
+        } else if (auto problem = formatProblem(entry)) {
+            result.status = VerifyStatus::Invalid;
+            result.error = std::move(*problem);
+        } else if (entry.contentHash.empty()) {
+            result.status = VerifyStatus::NotHashed;
+        } else {
+            const auto key = std::make_pair(info.st_dev, info.st_ino);
+            auto it = hashedInodes.find(key);
+            try {
+                if (it == hashedInodes.end()) {
+                    it = hashedInodes.emplace(key, contentHashOfFile(entry.storedPath)).first;
+                    report.bytesHashed += static_cast<std::uint64_t>(info.st_size);
+                }
+                result.actualHash = it->second;
+                result.status = result.actualHash == entry.contentHash ? VerifyStatus::Ok : VerifyStatus::Mismatch;
+            } catch (const std::exception &error) {
+                result.status = VerifyStatus::Unreadable;
+                result.error = error.what();
+            }
+        }
+        report.results.push_back(std::move(result));
+
+        if (progress && !progress(index + 1, entries.size())) {
+            report.cancelled = true;
+            break;
+        }
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+const char *verifyStatusName(VerifyStatus status)
+{
+    switch (status) {
+    case VerifyStatus::Ok:
+        return "ok";
+    case VerifyStatus::Mismatch:
+        return "mismatch";
+    case VerifyStatus::Missing:
+        return "missing";
+    case VerifyStatus::Unreadable:
+        return "unreadable";
+    case VerifyStatus::NotHashed:
+        return "not-hashed";
+    case VerifyStatus::Invalid:
+        return "invalid";
+    }
+    return "unknown";
+}
+
+} // namespace appimagelauncher
@@ -0,0 +1,300 @@
+#include "AppImageManager/LaunchPrefetcher.h"
+
+#include "AppImageManager/AppImageValidator.h"
+#include "AppImageManager/FileDescriptor.h"
+#include "AppImageManager/MappedFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace appimagelauncher {
+
+namespace {
+
+constexpr double kColdResidency = 0.5;
+constexpr double kHalfLifeSeconds = 7 * 24 * 3600.0;
+constexpr std::uint64_t kMaxHistoryBytes = 256 * 1024;
+// The runtime and the start of the payload: superblock and the first blocks read on mount.
+constexpr std::uint64_t kHeaderWindow = 64 * 1024;
+
+std::uint64_t pageSize()
+{
+    static const auto size = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+// One byte per page of the mapping; bit 0 is set for pages in the page cache.
+std::vector<unsigned char> residentPages(const MappedFile &file)
+{
+    std::vector<unsigned char> pages((file.size() + pageSize() - 1) / pageSize());
+    if (!pages.empty() && ::mincore(const_cast<unsigned char *>(file.data()), file.size(), pages.data()) != 0) {
+        throw std::runtime_error(std::string("mincore failed: ") + std::strerror(errno));
+    }
+    return pages;
+}
+
+std::uint64_t residentBytes(const std::vector<unsigned char> &pages, std::uint64_t fileSize)
+{
+    const auto count = static_cast<std::uint64_t>(
+        std::count_if(pages.begin(), pages.end(), [](unsigned char page) { return (page & 1) != 0; }));
+    return std::min(count * pageSize(), fileSize);
+}
+
+// The file split into byte ranges in the order a launch reads them; see prefetchAppImage().
+std::vector<std::pair<std::uint64_t, std::uint64_t>> launchOrder(const std::filesystem::path &path, std::uint64_t size)
+{
+    try {
+        const AppImageFormat format = validateAppImage(path);
+        const std::uint64_t header = std::min(size, format.payloadOffset + kHeaderWindow);
+        const std::uint64_t metadata = std::min(size, format.payloadOffset + format.metadataOffset);
+        const std::uint64_t payloadEnd = std::min(size, format.payloadOffset + format.payloadSize);
+        if (format.type == 2 && header < metadata) {
+            return { { 0, header }, { metadata, payloadEnd }, { header, metadata }, { payloadEnd, size } };
+        }
+    } catch (const std::exception &) {
+        // Still worth warming front to back.
+    }
+    return { { 0, size } };
+}
+
+std::int64_t currentTime()
+{
+    return static_cast<std::int64_t>(std::time(nullptr));
+}
+
+} // namespace
+
+LaunchHistory::LaunchHistory(std::filesystem::path path)
+    : m_path(std::move(path))
+{
+}
+
+void LaunchHistory::record(const std::string &id, double residency) const noexcept
+{
+    char line[256];
+    const int length = std::snprintf(line, sizeof(line), "%lld\t%s\t%.3f\n", static_cast<long long>(currentTime()),
+        id.c_str(), residency);
+    if (length <= 0 || static_cast<std::size_t>(length) >= sizeof(line)) {
+        return;
+    }
+
+    // A second attempt covers the log being compacted by another process while this one
+    // waited for the lock: the descriptor then refers to the replaced file.
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const FileDescriptor fd(::open(m_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644));
+        if (fd.get() < 0 || ::flock(fd.get(), LOCK_EX) != 0) {
+            return;
+        }
+        struct stat opened {};
+        struct stat current {};
+        if (::fstat(fd.get(), &opened) != 0 || ::stat(m_path.c_str(), &current) != 0 || opened.st_ino != current.st_ino
+            || opened.st_dev != current.st_dev) {
+            continue;
+        }
+        if (::write(fd.get(), line, static_cast<std::size_t>(length)) != length) {
+            return;
+        }
+        if (static_cast<std::uint64_t>(opened.st_size) + static_cast<std::uint64_t>(length) <= kMaxHistoryBytes) {
+            return;
+        }
+
+        // Still holding the lock: keep the newer half and swap it in.
+        try {
+            std::ifstream input(m_path, std::ios::binary);
+            const std::string content((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+            const std::size_t cut = content.find('\n', content.size() / 2);
+            std::filesystem::path temporary = m_path;
+            temporary += ".tmp";
+            {
+                std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+                output << (cut == std::string::npos ? std::string() : content.substr(cut + 1));
+                if (!output) {
+                    return;
+                }
+            }
+            std::filesystem::rename(temporary, m_path);
+        } catch (const std::exception &) {
+            // The log keeps growing until a later launch manages to compact it.
+        }
+        return;
+    }
+}
+
+std::vector<LaunchStats> LaunchHistory::stats() const
+{
+    std::ifstream stream(m_path);
+    std::unordered_map<std::string, LaunchStats> byId;
+    const std::int64_t now = currentTime();
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream fields(line);
+        long long time = 0;
+        std::string id;
+        double residency = 0.0;
+        if (!(fields >> time >> id >> residency)) {
+            continue;
+        }
+        LaunchStats &stats = byId[id];
+        stats.id = id;
+        ++stats.launches;
+        stats.coldLaunches += residency < kColdResidency ? 1 : 0;
+        stats.meanResidency += residency;
+        stats.lastLaunch = std::max<std::int64_t>(stats.lastLaunch, time);
+        stats.score += std::pow(0.5, static_cast<double>(std::max<std::int64_t>(0, now - time)) / kHalfLifeSeconds);
+    }
+
+    std::vector<LaunchStats> result;
+    result.reserve(byId.size());
+    for (auto &pair : byId) {
+        pair.second.meanResidency /= static_cast<double>(pair.second.launches);
+        result.push_back(std::move(pair.second));
+    }
+    std::sort(result.begin(), result.end(), [](const LaunchStats &lhs, const LaunchStats &rhs) {
+        if (lhs.score != rhs.score) {
+            return lhs.score > rhs.score;
+        }
+        return lhs.lastLaunch != rhs.lastLaunch ? lhs.lastLaunch > rhs.lastLaunch : lhs.id < rhs.id;
+    });
+    return result;
+}
+
+double PrefetchResult::residency() const
+{
+    return fileBytes > 0 ? static_cast<double>(residentBytes) / static_cast<double>(fileBytes) : 0.0;
+}
+
+PrefetchResult pageCacheResidency(const std::filesystem::path &path)
+{
+    PrefetchResult result;
+    result.path = path;
+    try {
+        const MappedFile file(path);
+        result.fileBytes = file.size();
+        result.residentBytes = residentBytes(residentPages(file), file.size());
+    } catch (const std::exception &error) {
+        result.error = error.what();
+    }
+    return result;
+}
+
+std::uint64_t prefetchBudget()
+{
+    std::ifstream stream("/proc/meminfo");
+    std::string line;
+    while (std::getline(stream, line)) {
+        unsigned long long kilobytes = 0;
+        if (std::sscanf(line.c_str(), "MemAvailable: %llu kB", &kilobytes) == 1) {
+            return static_cast<std::uint64_t>(kilobytes) * 1024 / 4;
+        }
+    }
+    return 0;
+}
+
+PrefetchResult prefetchAppImage(const std::filesystem::path &path, std::uint64_t maxBytes)
+{
+    PrefetchResult result;
+    result.path = path;
+    try {
+        const MappedFile file(path);
+        const std::vector<unsigned char> pages = residentPages(file);
+        result.fileBytes = file.size();
+        result.residentBytes = residentBytes(pages, file.size());
+
+        const FileDescriptor fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        if (fd.get() < 0) {
+            throw std::runtime_error("Unable to open " + path.string() + ": " + std::strerror(errno));
+        }
+        std::uint64_t budget = maxBytes;
+        for (const auto &range : launchOrder(path, file.size())) {
+            // Only runs of pages that are not cached yet count against the budget.
+            std::uint64_t page = range.first / pageSize();
+            const std::uint64_t end = (range.second + pageSize() - 1) / pageSize();
+            while (page < end && budget > 0) {
+                if ((pages[page] & 1) != 0) {
+                    ++page;
+                    continue;
+                }
+                std::uint64_t last = page;
+                while (last < end && (pages[last] & 1) == 0) {
+                    ++last;
+                }
+                const std::uint64_t length = std::min((last - page) * pageSize(), budget);
+                const int error = ::posix_fadvise(fd.get(), static_cast<off_t>(page * pageSize()),
+                    static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+                if (error != 0) {
+                    throw std::runtime_error(std::string("posix_fadvise failed: ") + std::strerror(error));
+                }
+                result.requestedBytes += length;
+                budget -= length;
+                page = last;
+            }
+        }
+    } catch (const std::exception &error) {
+        result.error = error.what();
+    }
+    return result;
+}
+
+std::vector<PrefetchResult> prefetchHottest(const std::vector<AppImageEntry> &entries, const LaunchHistory &history,
+    std::size_t count, std::uint64_t budget)
+{
+    std::unordered_map<std::string, const AppImageEntry *> entriesById;
+    for (const auto &entry : entries) {
+        entriesById.emplace(entry.id, &entry);
+    }
+
+    std::vector<PrefetchResult> results;
+    for (const auto &stats : history.stats()) {
+        if (results.size() == count) {
+            break;
+        }
+        const auto it = entriesById.find(stats.id);
+        if (it == entriesById.end()) {
+            continue;
+        }
+        PrefetchResult result = prefetchAppImage(it->second->storedPath, budget);
+        result.id = stats.id;
+        budget -= std::min(budget, result.requestedBytes);
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+void prepareLaunch(const std::filesystem::path &historyPath, const AppImageEntry &entry) noexcept
+{
+    try {
+        const PrefetchResult result = prefetchDisabled() ? pageCacheResidency(entry.storedPath)
+                                                         : prefetchAppImage(entry.storedPath, prefetchBudget());
+        if (result.error.empty()) {
+            LaunchHistory(historyPath).record(entry.id, result.residency());
+        }
+    } catch (const std::exception &) {
+        // Only an optimisation; the launch goes ahead regardless.
+    }
+}
+
+bool prefetchDisabled()
+{
+    const char *disabled = std::getenv("APPIMAGEMANAGER_NO_PREFETCH");
+    return disabled && *disabled != '\0';
+}
+
+} // namespace appimagelauncher
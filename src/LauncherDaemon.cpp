@@ -0,0 +1,166 @@
+#include "AppImageManager/LauncherDaemon.h"
+
+#include "AppImageManager/CliCommands.h"
+#include "AppImageManager/LaunchPrefetcher.h"
+
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QProcess>
+#include <QTimer>
+
+#include <exception>
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+namespace appimagelauncher {
+
+namespace {
+constexpr int kMaxRequestBytes = 64 * 1024;
+constexpr int kProbeTimeoutMilliseconds = 200;
+} // namespace
+
+LauncherDaemon::LauncherDaemon(AppImageManager &manager, QObject *parent)
+    : QObject(parent)
+    , m_manager(manager)
+    , m_server(new QLocalServer(this))
+{
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &LauncherDaemon::onNewConnection);
+}
+
+bool LauncherDaemon::listen(QString *errorMessage)
+{
+    const QString socketPath = QString::fromStdString(daemonSocketPath().string());
+
+    QLocalSocket probe;
+    probe.connectToServer(socketPath);
+    if (probe.waitForConnected(kProbeTimeoutMilliseconds)) {
+        if (errorMessage) {
+            *errorMessage = QStringLiteral("Another AppImage Manager daemon is already listening on %1").arg(socketPath);
+        }
+        return false;
+    }
+
+    // Nobody answered, so any socket file left behind is stale.
+    QLocalServer::removeServer(socketPath);
+    if (!m_server->listen(socketPath)) {
+        if (errorMessage) {
+            *errorMessage = m_server->errorString();
+        }
+        return false;
+    }
+
+    // The daemon normally starts with the session, which makes this the time to warm the
+    // AppImages launched most. The reads are only queued, so requests are served meanwhile.
+    if (!prefetchDisabled()) {
+        QTimer::singleShot(0, this, [this]() {
+            prefetchHottest(m_manager.entries(), LaunchHistory(m_manager.launchHistoryPath()), kDefaultPrefetchCount,
+                prefetchBudget());
+        });
+    }
+    return true;
+}
+
+void LauncherDaemon::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+    }
+}
+
+void LauncherDaemon::onReadyRead(QLocalSocket *socket)
+{
+    if (!socket->canReadLine()) {
+        if (socket->bytesAvailable() > kMaxRequestBytes) {
+            socket->abort();
+        }
+        return;
+    }
+
+    const QByteArray line = socket->readLine(kMaxRequestBytes);
+    const DaemonReply reply = handleRequest(decodeDaemonRequest(std::string_view(line.constData(), static_cast<std::size_t>(line.size()))));
+    const std::string data = encodeDaemonReply(reply);
+    socket->write(data.data(), static_cast<qint64>(data.size()));
+    socket->disconnectFromServer();
+}
+
+DaemonReply LauncherDaemon::handleRequest(const DaemonRequest &request)
+{
+    DaemonReply reply;
+    const auto &arguments = request.arguments;
+    if (arguments.empty()) {
+        reply.exitCode = kDaemonFallbackExitCode;
+        return reply;
+    }
+
+    std::ostringstream out;
+    std::ostringstream err;
+    const std::string &command = arguments.front();
+    try {
+        m_manager.reloadIfChanged();
+
+        if (command == "list") {
+            reply.exitCode = runListCommand(m_manager, { arguments.begin() + 1, arguments.end() }, out, err);
+        } else if (command == "search") {
+            reply.exitCode = runSearchCommand(m_manager, { arguments.begin() + 1, arguments.end() }, out, err);
+        } else if (command == "autostart") {
+            reply.exitCode = runAutostartCommand(m_manager, { arguments.begin() + 1, arguments.end() }, out, err);
+        } else if (command == "open") {
+            reply.exitCode = openTarget(request, err);
+        } else if (command == "stop") {
+            out << "AppImage Manager daemon stopping" << std::endl;
+            QTimer::singleShot(0, QCoreApplication::instance(), &QCoreApplication::quit);
+        } else {
+            reply.exitCode = kDaemonFallbackExitCode;
+        }
+    } catch (const std::exception &error) {
+        err << "Error: " << error.what() << std::endl;
+        reply.exitCode = 1;
+    }
+
+    reply.out = out.str();
+    reply.err = err.str();
+    return reply;
+}
+
+int LauncherDaemon::openTarget(const DaemonRequest &request, std::ostream &err)
+{
+    if (request.arguments.size() < 2) {
+        err << "Missing AppImage identifier or path" << std::endl;
+        return 1;
+    }
+
+    const std::string &target = request.arguments[1];
+    auto entry = m_manager.entryById(target);
+    if (!entry.has_value()) {
+        std::filesystem::path candidate(target);
+        if (candidate.is_relative()) {
+            candidate = request.workingDirectory / candidate;
+        }
+        if (!std::filesystem::exists(candidate)) {
+            err << "Unknown AppImage target: " << target << std::endl;
+            return 1;
+        }
+
+        entry = m_manager.entryByStoredPath(candidate);
+        if (!entry.has_value()) {
+            entry = m_manager.entryByOriginalPath(candidate);
+        }
+        if (!entry.has_value()) {
+            // Registering a new AppImage prompts the user; let the client do that.
+            return kDaemonFallbackExitCode;
+        }
+    }
+
+    prepareLaunch(m_manager.launchHistoryPath(), *entry);
+    if (!QProcess::startDetached(QString::fromStdString(entry->storedPath.string()), {})) {
+        err << "Unable to start the AppImage: " << entry->storedPath.string() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace appimagelauncher
@@ -0,0 +1,52 @@
+#include "AppImageManager/LibraryWatcher.h"
+
+#include <QFile>
+
+#include <utility>
+
+namespace appimagelauncher {
+
+namespace {
+// Long enough to cover a CLI batch or a file manager deleting several AppImages, short
+// enough to feel immediate.
+constexpr int kDebounceMilliseconds = 250;
+} // namespace
+
+LibraryWatcher::LibraryWatcher(const AppImageManager &manager, QObject *parent)
+    : QObject(parent)
+{
+    m_paths << QFile::decodeName(manager.manifestLockPath().c_str())
+            << QFile::decodeName(manager.storageDirectory().c_str());
+    if (!manager.autostartDirectory().empty()) {
+        m_paths << QFile::decodeName(manager.autostartDirectory().c_str());
+    }
+    watchPaths();
+
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(kDebounceMilliseconds);
+    connect(&m_debounce, &QTimer::timeout, this, [this]() {
+        watchPaths();
+        emit libraryChanged();
+    });
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, &LibraryWatcher::onPathChanged);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &LibraryWatcher::onPathChanged);
+}
+
+void LibraryWatcher::onPathChanged()
+{
+    m_debounce.start();
+}
+
+// QFileSystemWatcher drops paths that are deleted or replaced; put back any that exist
+// again.
+void LibraryWatcher::watchPaths()
+{
+    const QStringList watched = m_watcher.files() + m_watcher.directories();
+    for (const QString &path : std::as_const(m_paths)) {
+        if (!watched.contains(path) && QFile::exists(path)) {
+            m_watcher.addPath(path);
+        }
+    }
+}
+
+} // namespace appimagelauncher
@@ -1,5 +1,14 @@
 #include "AppImageManager/MainWindow.h"
 
+#include "AppImageManager/AppImageFilterModel.h"
+#include "AppImageManager/AppImageListModel.h"
+#include "AppImageManager/CliCommands.h"
+#include "AppImageManager/FunctionTask.h"
+#include "AppImageManager/ImportQueue.h"
+#include "AppImageManager/InboxWatcher.h"
+#include "AppImageManager/IntegrityVerifier.h"
+#include "AppImageManager/LaunchPrefetcher.h"
+#include "AppImageManager/LibraryWatcher.h"
 #include "AppImageManager/SettingsDialog.h"
 
 #include <QAction>
@@ -7,24 +16,26 @@
 #include <QApplication>
 #include <QCoreApplication>
 #include <QDesktopServices>
+#include <QDragEnterEvent>
+#include <QDropEvent>
 #include <QEvent>
 #include <QFileDialog>
-#include <QFileIconProvider>
-#include <QFileInfo>
+#include <QHBoxLayout>
 #include <QInputDialog>
+#include <QItemSelectionModel>
 #include <QListView>
-#include <QListWidget>
-#include <QListWidgetItem>
 #include <QLineEdit>
-#include <QColor>
+#include <QLocale>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
-#include <QPainter>
+#include <QMimeData>
 #include <QProcess>
+#include <QProgressBar>
 #include <QStatusBar>
 #include <QStyle>
 #include <QToolBar>
+#include <QToolButton>
 #include <QUrl>
 #include <QVBoxLayout>
 #include <QWidget>
@@ -39,48 +50,6 @@
 namespace appimagelauncher {
 
 namespace {
-constexpr int kIdRole = Qt::UserRole;
-constexpr int kAutostartRole = Qt::UserRole + 1;
-
-QString initialsForName(const QString &name)
-{
-    const QString trimmed = name.trimmed();
-    if (trimmed.isEmpty()) {
-        return QStringLiteral("A");
-    }
-
-    QString initials;
-    bool takeNext = true;
-    for (const QChar &ch : trimmed) {
-        if (ch.isSpace()) {
-            takeNext = true;
-            continue;
-        }
-        if (takeNext) {
-            initials.append(ch);
-            takeNext = false;
-            if (initials.size() >= 2) {
-                break;
-            }
-        }
-    }
-
-    if (initials.isEmpty()) {
-        initials = trimmed.left(2);
-    }
-
-    return initials.toUpper();
-}
-
-QColor accentColorForId(const std::string &id)
-{
-    const std::size_t hash = std::hash<std::string> {}(id);
-    const int hue = static_cast<int>(hash % 360);
-    QColor color;
-    color.setHsl(hue, 150, 140);
-    return color;
-}
-
 QIcon themedIcon(const QString &name, QStyle::StandardPixmap fallback)
 {
     QIcon icon = QIcon::fromTheme(name);
@@ -97,7 +66,14 @@ MainWindow::MainWindow(AppImageManager &manager, TranslationManager &translator,
     , m_manager(manager)
     , m_translationManager(translator)
     , m_preferences(std::move(preferences))
-    , m_listWidget(nullptr)
+    , m_iconCache(new IconCache(this))
+    , m_model(new AppImageListModel(manager, m_iconCache, this))
+    , m_filterModel(new AppImageFilterModel(m_model, this))
+    , m_importQueue(new ImportQueue(manager, this))
+    , m_libraryWatcher(new LibraryWatcher(manager, this))
+    , m_inboxWatcher(new InboxWatcher(this))
+    , m_searchEdit(nullptr)
+    , m_listView(nullptr)
     , m_addAction(nullptr)
     , m_removeAction(nullptr)
     , m_openAction(nullptr)
@@ -105,6 +81,8 @@ MainWindow::MainWindow(AppImageManager &manager, TranslationManager &translator,
     , m_autostartAction(nullptr)
     , m_renameAction(nullptr)
     , m_settingsAction(nullptr)
+    , m_verifyAction(nullptr)
+    , m_cleanUpAction(nullptr)
     , m_quitAction(nullptr)
     , m_viewListAction(nullptr)
     , m_viewGridAction(nullptr)
@@ -113,6 +91,9 @@ MainWindow::MainWindow(AppImageManager &manager, TranslationManager &translator,
     , m_viewMenu(nullptr)
     , m_preferencesMenu(nullptr)
     , m_viewActions(nullptr)
+    , m_verifyProgress(nullptr)
+    , m_storageProgress(nullptr)
+    , m_cancelBackgroundTasks(false)
 {
     createUi();
     retranslateUi();
@@ -123,13 +104,20 @@ MainWindow::MainWindow(AppImageManager &manager, TranslationManager &translator,
         retranslateUi();
     }
 
-    refreshEntries();
+    m_model->reload();
     updateActionsForSelection();
+    watchInbox();
 
     setMinimumSize(720, 460);
     setUnifiedTitleAndToolBarOnMac(true);
 }
 
+MainWindow::~MainWindow()
+{
+    m_cancelBackgroundTasks = true;
+    m_backgroundPool.waitForDone();
+}
+
 void MainWindow::createUi()
 {
     createToolBar();
@@ -140,20 +128,40 @@ void MainWindow::createUi()
     layout->setContentsMargins(12, 12, 12, 12);
     layout->setSpacing(8);
 
-    m_listWidget = new QListWidget(central);
-    m_listWidget->setSelectionMode(QAbstractItemView::SingleSelection);
-    m_listWidget->setAlternatingRowColors(true);
-    m_listWidget->setUniformItemSizes(false);
-    m_listWidget->setSpacing(6);
-    m_listWidget->setIconSize(QSize(72, 72));
-    m_listWidget->setContextMenuPolicy(Qt::CustomContextMenu);
-    layout->addWidget(m_listWidget);
+    m_searchEdit = new QLineEdit(central);
+    m_searchEdit->setClearButtonEnabled(true);
+    layout->addWidget(m_searchEdit);
+
+    m_listView = new QListView(central);
+    m_listView->setModel(m_filterModel);
+    m_listView->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_listView->setAlternatingRowColors(true);
+    // Every row has the same size, so the view lays out large libraries without asking
+    // each row for its data; decorations are only fetched for rows that are painted.
+    m_listView->setUniformItemSizes(true);
+    m_listView->setSpacing(6);
+    m_listView->setIconSize(QSize(72, 72));
+    m_listView->setContextMenuPolicy(Qt::CustomContextMenu);
+    layout->addWidget(m_listView);
 
     setCentralWidget(central);
 
-    connect(m_listWidget, &QListWidget::itemDoubleClicked, this, [this](QListWidgetItem *) { onOpenSelected(); });
-    connect(m_listWidget, &QListWidget::itemSelectionChanged, this, [this]() { updateActionsForSelection(); });
-    connect(m_listWidget, &QListWidget::customContextMenuRequested, this, &MainWindow::onContextMenuRequested);
+    connect(m_searchEdit, &QLineEdit::textChanged, m_filterModel, &AppImageFilterModel::setQuery);
+    connect(m_listView, &QListView::doubleClicked, this, [this](const QModelIndex &) { onOpenSelected(); });
+    connect(m_listView->selectionModel(), &QItemSelectionModel::selectionChanged, this, [this]() { updateActionsForSelection(); });
+    connect(m_listView, &QListView::customContextMenuRequested, this, &MainWindow::onContextMenuRequested);
+    connect(m_model, &QAbstractItemModel::rowsInserted, this, &MainWindow::updateStatusMessage);
+    connect(m_model, &QAbstractItemModel::rowsRemoved, this, &MainWindow::updateStatusMessage);
+    connect(m_model, &QAbstractItemModel::modelReset, this, &MainWindow::updateStatusMessage);
+
+    setAcceptDrops(true);
+    connect(m_importQueue, &ImportQueue::jobQueued, this, &MainWindow::onImportQueued);
+    connect(m_importQueue, &ImportQueue::jobProgress, this, &MainWindow::onImportProgress);
+    connect(m_importQueue, &ImportQueue::jobFinished, this, &MainWindow::onImportFinished);
+    connect(m_importQueue, &ImportQueue::jobFailed, this, &MainWindow::onImportFailed);
+    connect(m_importQueue, &ImportQueue::jobCancelled, this, &MainWindow::removeImportIndicator);
+    connect(m_libraryWatcher, &LibraryWatcher::libraryChanged, this, &MainWindow::onLibraryChanged);
+    connect(m_inboxWatcher, &InboxWatcher::appImagesArrived, this, &MainWindow::onInboxArrivals);
 }
 
 void MainWindow::createToolBar()
@@ -199,6 +207,12 @@ void MainWindow::createMenus()
     m_fileMenu->addAction(m_removeAction);
     m_fileMenu->addSeparator();
     m_fileMenu->addAction(m_openStorageAction);
+    m_verifyAction = new QAction(this);
+    connect(m_verifyAction, &QAction::triggered, this, &MainWindow::onVerifyLibrary);
+    m_fileMenu->addAction(m_verifyAction);
+    m_cleanUpAction = new QAction(this);
+    connect(m_cleanUpAction, &QAction::triggered, this, &MainWindow::onCleanUpStorage);
+    m_fileMenu->addAction(m_cleanUpAction);
     m_fileMenu->addSeparator();
 
     m_quitAction = new QAction(this);
@@ -216,7 +230,6 @@ void MainWindow::createMenus()
         if (m_preferences.viewMode != ViewMode::List) {
             m_preferences.viewMode = ViewMode::List;
             applyViewMode();
-            refreshEntries();
             m_preferences.save();
         }
     });
@@ -228,7 +241,6 @@ void MainWindow::createMenus()
         if (m_preferences.viewMode != ViewMode::Grid) {
             m_preferences.viewMode = ViewMode::Grid;
             applyViewMode();
-            refreshEntries();
             m_preferences.save();
         }
     });
@@ -251,6 +263,10 @@ void MainWindow::retranslateUi()
         m_actionToolBar->setWindowTitle(tr("Actions"));
     }
 
+    if (m_searchEdit) {
+        m_searchEdit->setPlaceholderText(tr("Search by name, id or category"));
+    }
+
     if (m_fileMenu) {
         m_fileMenu->setTitle(tr("File"));
     }
@@ -288,6 +304,20 @@ void MainWindow::retranslateUi()
         m_settingsAction->setText(tr("Preferences"));
         m_settingsAction->setToolTip(tr("Open application settings"));
     }
+    if (m_verifyAction) {
+        m_verifyAction->setText(tr("Verify Library"));
+        m_verifyAction->setToolTip(tr("Check managed AppImages against the hashes recorded when they were added"));
+    }
+    if (m_verifyProgress) {
+        m_verifyProgress->setFormat(tr("Verifying %p%"));
+    }
+    if (m_cleanUpAction) {
+        m_cleanUpAction->setText(tr("Clean Up Storage"));
+        m_cleanUpAction->setToolTip(tr("Find leftover files, untracked AppImages and stale autostart entries"));
+    }
+    if (m_storageProgress) {
+        m_storageProgress->setToolTip(tr("Checking storage"));
+    }
     if (m_quitAction) {
         m_quitAction->setText(tr("Quit"));
         m_quitAction->setToolTip(tr("Quit AppImage Manager"));
@@ -298,24 +328,28 @@ void MainWindow::retranslateUi()
     if (m_viewGridAction) {
         m_viewGridAction->setText(tr("Grid view"));
     }
+    for (const auto &indicator : std::as_const(m_importIndicators)) {
+        indicator.cancelButton->setToolTip(tr("Cancel import"));
+    }
 
     updateActionsForSelection();
 }
 
 void MainWindow::applyViewMode()
 {
-    if (!m_listWidget) {
+    if (!m_listView) {
         return;
     }
 
     const bool grid = m_preferences.viewMode == ViewMode::Grid;
-    m_listWidget->setViewMode(grid ? QListView::IconMode : QListView::ListMode);
-    m_listWidget->setResizeMode(grid ? QListView::Adjust : QListView::Fixed);
-    m_listWidget->setWrapping(grid);
-    m_listWidget->setWordWrap(grid);
-    m_listWidget->setSpacing(grid ? 16 : 6);
-    m_listWidget->setIconSize(grid ? QSize(96, 96) : QSize(48, 48));
-    m_listWidget->setGridSize(grid ? QSize(200, 160) : QSize());
+    m_listView->setViewMode(grid ? QListView::IconMode : QListView::ListMode);
+    m_listView->setResizeMode(grid ? QListView::Adjust : QListView::Fixed);
+    m_listView->setWrapping(grid);
+    m_listView->setWordWrap(grid);
+    m_listView->setSpacing(grid ? 16 : 6);
+    m_listView->setIconSize(grid ? QSize(96, 96) : QSize(48, 48));
+    m_listView->setGridSize(grid ? QSize(200, 160) : QSize());
+    m_model->setViewMode(m_preferences.viewMode);
 
     if (m_viewListAction && m_viewGridAction) {
         m_viewListAction->setChecked(!grid);
@@ -323,97 +357,22 @@ void MainWindow::applyViewMode()
     }
 }
 
-void MainWindow::refreshEntries()
+void MainWindow::updateStatusMessage()
 {
-    if (!m_listWidget) {
-        return;
-    }
-
-    const QString currentId = [&]() -> QString {
-        const auto items = m_listWidget->selectedItems();
-        if (!items.isEmpty()) {
-            return items.front()->data(kIdRole).toString();
-        }
-        return QString();
-    }();
-
-    m_listWidget->clear();
-
-    auto entries = m_manager.entries();
-    std::sort(entries.begin(), entries.end(), [](const AppImageEntry &lhs, const AppImageEntry &rhs) {
-        return QString::fromStdString(lhs.name).localeAwareCompare(QString::fromStdString(rhs.name)) < 0;
-    });
-
-    for (const auto &entry : entries) {
-        auto *item = new QListWidgetItem();
-        item->setData(kIdRole, QString::fromStdString(entry.id));
-        item->setData(kAutostartRole, entry.autostart);
-        rebuildItem(item, entry);
-        m_listWidget->addItem(item);
-
-        if (!currentId.isEmpty() && currentId == QString::fromStdString(entry.id)) {
-            m_listWidget->setCurrentItem(item);
-        }
-    }
-
-    updateActionsForSelection();
-
-    const int count = static_cast<int>(entries.size());
-    statusBar()->showMessage(tr("%n AppImage(s) managed", "", count));
-}
-
-void MainWindow::rebuildItem(QListWidgetItem *item, const AppImageEntry &entry)
-{
-    item->setText(decoratedName(entry));
-    item->setIcon(avatarForEntry(entry));
-    item->setToolTip(QString::fromStdString(entry.storedPath.string()));
-
-    if (m_preferences.viewMode == ViewMode::Grid) {
-        item->setTextAlignment(Qt::AlignHCenter | Qt::AlignBottom);
-    } else {
-        item->setTextAlignment(Qt::AlignVCenter | Qt::AlignLeft);
-    }
-}
-
-QIcon MainWindow::avatarForEntry(const AppImageEntry &entry) const
-{
-    QFileInfo fileInfo(QString::fromStdString(entry.storedPath.string()));
-    QFileIconProvider provider;
-    QIcon icon = provider.icon(fileInfo);
-    if (!icon.isNull()) {
-        return icon;
-    }
-
-    const QString initials = initialsForName(QString::fromStdString(entry.name));
-    const QColor background = accentColorForId(entry.id);
-    const int size = m_preferences.viewMode == ViewMode::Grid ? 128 : 64;
-
-    QPixmap pixmap(size, size);
-    pixmap.fill(Qt::transparent);
-
-    QPainter painter(&pixmap);
-    painter.setRenderHint(QPainter::Antialiasing, true);
-    painter.setBrush(background);
-    painter.setPen(Qt::NoPen);
-    painter.drawEllipse(pixmap.rect().adjusted(2, 2, -2, -2));
-
-    QFont font = painter.font();
-    font.setBold(true);
-    font.setPixelSize(size / 2);
-    painter.setFont(font);
-    painter.setPen(Qt::white);
-    painter.drawText(pixmap.rect(), Qt::AlignCenter, initials);
-
-    return QIcon(pixmap);
+    statusBar()->showMessage(tr("%n AppImage(s) managed", "", m_model->rowCount()));
 }
 
-QString MainWindow::decoratedName(const AppImageEntry &entry) const
+// Another process or the user's file manager changed the library; catch up without
+// resetting the view.
+void MainWindow::onLibraryChanged()
 {
-    QString text = QString::fromStdString(entry.name);
-    if (entry.autostart) {
-        text += tr(" (Autostart)");
+    try {
+        m_manager.reloadIfChanged();
+    } catch (const std::exception &) {
+        // Keep showing what was loaded; the next change notification retries.
     }
-    return text;
+    m_model->syncWithManager();
+    updateActionsForSelection();
 }
 
 void MainWindow::updateActionsForSelection()
@@ -451,16 +410,16 @@ void MainWindow::updateActionsForSelection()
 
 std::optional<AppImageEntry> MainWindow::selectedEntry() const
 {
-    if (!m_listWidget) {
+    if (!m_listView) {
         return std::nullopt;
     }
 
-    const auto items = m_listWidget->selectedItems();
-    if (items.isEmpty()) {
+    const auto indexes = m_listView->selectionModel()->selectedIndexes();
+    if (indexes.isEmpty()) {
         return std::nullopt;
     }
 
-    const QString id = items.front()->data(kIdRole).toString();
+    const QString id = indexes.front().data(AppImageListModel::IdRole).toString();
     if (id.isEmpty()) {
         return std::nullopt;
     }
@@ -479,9 +438,11 @@ void MainWindow::applyPreferences(const Preferences &preferences)
     const bool languageChanged = m_translationManager.applyLanguage(m_preferences.language);
 
     applyViewMode();
-    refreshEntries();
+    watchInbox();
     if (languageChanged) {
         retranslateUi();
+        m_model->retranslate();
+        updateStatusMessage();
     }
 }
 
@@ -490,25 +451,342 @@ void MainWindow::changeEvent(QEvent *event)
     QMainWindow::changeEvent(event);
     if (event->type() == QEvent::LanguageChange) {
         retranslateUi();
-        refreshEntries();
+        m_model->retranslate();
+        updateStatusMessage();
     }
 }
 
 void MainWindow::onAddAppImage()
 {
-    const QString filePath = QFileDialog::getOpenFileName(this,
-        tr("Select AppImage"),
+    const QStringList filePaths = QFileDialog::getOpenFileNames(this,
+        tr("Select AppImages"),
         QString(),
         tr("AppImage Files (*.AppImage);;All Files (*)"));
-    if (filePath.isEmpty()) {
-        return;
+    enqueueImports(filePaths);
+}
+
+void MainWindow::dragEnterEvent(QDragEnterEvent *event)
+{
+    const auto urls = event->mimeData()->urls();
+    if (std::any_of(urls.begin(), urls.end(), [](const QUrl &url) { return url.isLocalFile(); })) {
+        event->acceptProposedAction();
+    }
+}
+
+// Dropped directories contribute the AppImages they directly contain, as with "add".
+void MainWindow::dropEvent(QDropEvent *event)
+{
+    std::vector<std::string> arguments;
+    for (const QUrl &url : event->mimeData()->urls()) {
+        if (url.isLocalFile()) {
+            arguments.push_back(QFile::encodeName(url.toLocalFile()).toStdString());
+        }
     }
 
+    QStringList paths;
     try {
-        m_manager.addAppImage(std::filesystem::u8path(filePath.toUtf8().constData()), m_preferences.moveToStorageOnAdd);
-        refreshEntries();
+        for (const auto &path : collectAppImagePaths(arguments)) {
+            paths << QFile::decodeName(path.c_str());
+        }
     } catch (const std::exception &error) {
         QMessageBox::critical(this, tr("Unable to add AppImage"), QString::fromUtf8(error.what()));
+        return;
+    }
+    event->acceptProposedAction();
+    enqueueImports(paths);
+}
+
+void MainWindow::enqueueImports(const QStringList &paths)
+{
+    QStringList errors;
+    for (const QString &path : paths) {
+        try {
+            m_importQueue->enqueue(path, m_preferences.moveToStorageOnAdd);
+        } catch (const std::exception &error) {
+            errors << QString::fromUtf8(error.what());
+        }
+    }
+    if (!errors.isEmpty()) {
+        QMessageBox::critical(this, tr("Unable to add AppImage"), errors.join(QLatin1Char('\n')));
+    }
+}
+
+void MainWindow::watchInbox()
+{
+    const QString directory = m_preferences.inboxDirectory;
+    // Imports move files into storage, so watching storage itself would loop.
+    if (!directory.isEmpty()) {
+        std::error_code error;
+        if (std::filesystem::equivalent(QFile::encodeName(directory).toStdString(), m_manager.storageDirectory(), error)) {
+            m_inboxWatcher->setDirectory(QString());
+            QMessageBox::warning(this, tr("Unable to watch the inbox folder"),
+                tr("The inbox folder must not be the storage directory."));
+            return;
+        }
+    }
+
+    try {
+        m_inboxWatcher->setDirectory(directory);
+    } catch (const std::exception &error) {
+        QMessageBox::warning(this, tr("Unable to watch the inbox folder"), QString::fromUtf8(error.what()));
+    }
+}
+
+void MainWindow::onInboxArrivals(const QStringList &paths)
+{
+    // With "move into storage" off, imported AppImages stay in the inbox and may be
+    // reported again when they are rewritten.
+    QStringList fresh;
+    for (const QString &path : paths) {
+        if (!m_manager.entryByStoredPath(QFile::encodeName(path).toStdString())) {
+            fresh << path;
+        }
+    }
+    if (!fresh.isEmpty()) {
+        enqueueImports(fresh);
+    }
+}
+
+void MainWindow::onImportQueued(quint64 job, const QString &fileName)
+{
+    ImportIndicator indicator;
+    indicator.widget = new QWidget(statusBar());
+    auto *layout = new QHBoxLayout(indicator.widget);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->setSpacing(4);
+
+    indicator.progressBar = new QProgressBar(indicator.widget);
+    indicator.progressBar->setRange(0, 1000);
+    indicator.progressBar->setValue(0);
+    indicator.progressBar->setMaximumWidth(220);
+    indicator.progressBar->setFormat(fileName + QStringLiteral(" %p%"));
+    layout->addWidget(indicator.progressBar);
+
+    indicator.cancelButton = new QToolButton(indicator.widget);
+    indicator.cancelButton->setAutoRaise(true);
+    indicator.cancelButton->setIcon(themedIcon(QStringLiteral("process-stop"), QStyle::SP_DialogCancelButton));
+    indicator.cancelButton->setToolTip(tr("Cancel import"));
+    connect(indicator.cancelButton, &QToolButton::clicked, this, [this, job]() { m_importQueue->cancel(job); });
+    layout->addWidget(indicator.cancelButton);
+
+    statusBar()->addPermanentWidget(indicator.widget);
+    m_importIndicators.insert(job, indicator);
+}
+
+void MainWindow::onImportProgress(quint64 job, qint64 copied, qint64 total)
+{
+    const auto it = m_importIndicators.constFind(job);
+    if (it != m_importIndicators.constEnd()) {
+        it->progressBar->setValue(total > 0 ? static_cast<int>(copied * 1000 / total) : 1000);
+    }
+}
+
+void MainWindow::onImportFinished(quint64 job, const QString &id)
+{
+    removeImportIndicator(job);
+    const auto entry = m_manager.entryById(id.toStdString());
+    if (!entry) {
+        return;
+    }
+    m_model->entryAdded(*entry);
+    m_listView->setCurrentIndex(m_filterModel->mapFromSource(m_model->indexForId(id)));
+}
+
+void MainWindow::onImportFailed(quint64 job, const QString &fileName, const QString &message)
+{
+    removeImportIndicator(job);
+    QMessageBox::critical(this, tr("Unable to add AppImage"), fileName + QStringLiteral(": ") + message);
+}
+
+void MainWindow::removeImportIndicator(quint64 job)
+{
+    const ImportIndicator indicator = m_importIndicators.take(job);
+    if (indicator.widget) {
+        statusBar()->removeWidget(indicator.widget);
+        indicator.widget->deleteLater();
+    }
+}
+
+void MainWindow::onVerifyLibrary()
+{
+    if (m_verifyProgress) {
+        return;
+    }
+
+    const auto entries = m_manager.entries();
+    m_verifyAction->setEnabled(false);
+    m_verifyProgress = new QProgressBar(statusBar());
+    m_verifyProgress->setMaximumWidth(220);
+    m_verifyProgress->setRange(0, static_cast<int>(entries.size()));
+    m_verifyProgress->setValue(0);
+    m_verifyProgress->setFormat(tr("Verifying %p%"));
+    statusBar()->addPermanentWidget(m_verifyProgress);
+
+    m_backgroundPool.start(new FunctionTask([this, entries]() {
+        const VerifyReport report = verifyEntries(entries, [this](std::size_t done, std::size_t) {
+            QMetaObject::invokeMethod(this, [this, done]() {
+                if (m_verifyProgress) {
+                    m_verifyProgress->setValue(static_cast<int>(done));
+                }
+            }, Qt::QueuedConnection);
+            return !m_cancelBackgroundTasks;
+        });
+        QMetaObject::invokeMethod(this, [this, report]() { onVerifyFinished(report); }, Qt::QueuedConnection);
+    }));
+}
+
+void MainWindow::onVerifyFinished(const VerifyReport &report)
+{
+    statusBar()->removeWidget(m_verifyProgress);
+    m_verifyProgress->deleteLater();
+    m_verifyProgress = nullptr;
+    m_verifyAction->setEnabled(true);
+    if (report.cancelled) {
+        return;
+    }
+
+    QStringList problems;
+    int notHashed = 0;
+    for (const auto &result : report.results) {
+        QString status;
+        switch (result.status) {
+        case VerifyStatus::Ok:
+            continue;
+        case VerifyStatus::NotHashed:
+            ++notHashed;
+            continue;
+        case VerifyStatus::Mismatch:
+            status = tr("modified since it was added");
+            break;
+        case VerifyStatus::Missing:
+            status = tr("missing");
+            break;
+        case VerifyStatus::Unreadable:
+            status = tr("unreadable");
+            break;
+        case VerifyStatus::Invalid:
+            status = tr("not a valid AppImage");
+            break;
+        }
+        const auto entry = m_manager.entryById(result.id);
+        const QString name = QString::fromStdString(entry ? entry->name : result.id);
+        problems << tr("%1: %2").arg(name, status);
+    }
+
+    QString summary = tr("Verified %n AppImage(s) at %1 GB/s.", "", static_cast<int>(report.results.size()))
+                          .arg(QString::number(report.gigabytesPerSecond(), 'f', 2));
+    if (notHashed > 0) {
+        summary += QLatin1Char(' ');
+        summary += tr("%n AppImage(s) were added before hashes were recorded and were skipped.", "", notHashed);
+    }
+    if (problems.isEmpty()) {
+        QMessageBox::information(this, tr("Integrity check passed"), summary);
+    } else {
+        QMessageBox::warning(this, tr("Integrity check failed"), summary + QStringLiteral("\n\n") + problems.join(QLatin1Char('\n')));
+    }
+}
+
+void MainWindow::onCleanUpStorage()
+{
+    if (m_storageProgress) {
+        return;
+    }
+
+    const auto entries = m_manager.entries();
+    const auto storageDirectory = m_manager.storageDirectory();
+    const auto autostartDirectory = m_manager.autostartDirectory();
+    m_cleanUpAction->setEnabled(false);
+    m_storageProgress = new QProgressBar(statusBar());
+    m_storageProgress->setMaximumWidth(220);
+    // How many files there are is only known at the end.
+    m_storageProgress->setRange(0, 0);
+    m_storageProgress->setToolTip(tr("Checking storage"));
+    statusBar()->addPermanentWidget(m_storageProgress);
+
+    m_backgroundPool.start(new FunctionTask([this, entries, storageDirectory, autostartDirectory]() {
+        StorageReport report;
+        QString error;
+        try {
+            report = scanStorage(storageDirectory, autostartDirectory, entries,
+                [this](std::size_t) { return !m_cancelBackgroundTasks; });
+        } catch (const std::exception &exception) {
+            error = QString::fromUtf8(exception.what());
+        }
+        QMetaObject::invokeMethod(this, [this, report, error]() { onStorageCheckFinished(report, error); },
+            Qt::QueuedConnection);
+    }));
+}
+
+void MainWindow::onStorageCheckFinished(const StorageReport &report, const QString &error)
+{
+    statusBar()->removeWidget(m_storageProgress);
+    m_storageProgress->deleteLater();
+    m_storageProgress = nullptr;
+    m_cleanUpAction->setEnabled(true);
+    if (report.cancelled) {
+        return;
+    }
+    if (!error.isEmpty()) {
+        QMessageBox::critical(this, tr("Unable to check storage"), error);
+        return;
+    }
+    if (report.issues.empty()) {
+        QMessageBox::information(this, tr("Storage is clean"),
+            tr("Checked %n file(s); nothing needs cleaning up.", "", static_cast<int>(report.filesScanned)));
+        return;
+    }
+
+    int untracked = 0;
+    int leftovers = 0;
+    int missing = 0;
+    int autostart = 0;
+    for (const auto &issue : report.issues) {
+        switch (issue.kind) {
+        case StorageIssueKind::UntrackedAppImage:
+            ++untracked;
+            break;
+        case StorageIssueKind::InvalidFile:
+        case StorageIssueKind::StaleTemporary:
+        case StorageIssueKind::OrphanedVersions:
+            ++leftovers;
+            break;
+        case StorageIssueKind::MissingAppImage:
+            ++missing;
+            break;
+        case StorageIssueKind::StaleAutostart:
+        case StorageIssueKind::MissingAutostart:
+            ++autostart;
+            break;
+        }
+    }
+    QStringList plan;
+    if (untracked > 0) {
+        plan << tr("%n untracked AppImage(s) in storage will be added to the library.", "", untracked);
+    }
+    if (leftovers > 0) {
+        plan << tr("%n leftover file(s) will be deleted.", "", leftovers);
+    }
+    if (missing > 0) {
+        plan << tr("%n AppImage(s) whose file is gone will be restored from a kept version or removed.", "", missing);
+    }
+    if (autostart > 0) {
+        plan << tr("%n autostart file(s) will be deleted or rewritten.", "", autostart);
+    }
+    plan << tr("This frees %1.").arg(QLocale().formattedDataSize(static_cast<qint64>(report.reclaimableBytes)));
+    if (QMessageBox::question(this, tr("Clean Up Storage"), plan.join(QLatin1Char('\n')) + QStringLiteral("\n\n") + tr("Clean up now?"))
+        != QMessageBox::Yes) {
+        return;
+    }
+
+    try {
+        const auto result = m_manager.repairStorage(report);
+        m_model->syncWithManager();
+        updateActionsForSelection();
+        QMessageBox::information(this, tr("Clean Up Storage"),
+            tr("Repaired %n problem(s), freeing %1.", "", static_cast<int>(result.repaired))
+                .arg(QLocale().formattedDataSize(static_cast<qint64>(result.reclaimedBytes))));
+    } catch (const std::exception &exception) {
+        QMessageBox::critical(this, tr("Unable to clean up storage"), QString::fromUtf8(exception.what()));
     }
 }
 
@@ -527,7 +805,7 @@ void MainWindow::onRemoveSelected()
 
     try {
         m_manager.removeAppImage(entry->id);
-        refreshEntries();
+        m_model->entryRemoved(entry->id);
     } catch (const std::exception &error) {
         QMessageBox::critical(this, tr("Unable to remove"), QString::fromUtf8(error.what()));
     }
@@ -540,6 +818,7 @@ void MainWindow::onOpenSelected()
         return;
     }
 
+    prepareLaunch(m_manager.launchHistoryPath(), *entry);
     const QString executable = QString::fromStdString(entry->storedPath.string());
     if (!QProcess::startDetached(executable, {})) {
         QMessageBox::warning(this, tr("Launch failed"), tr("Unable to start the AppImage."));
@@ -561,7 +840,8 @@ void MainWindow::onToggleAutostart()
 
     try {
         m_manager.setAutostart(entry->id, !entry->autostart);
-        refreshEntries();
+        m_model->entryChanged(entry->id);
+        updateActionsForSelection();
     } catch (const std::exception &error) {
         promptAutostartFailure(error);
     }
@@ -598,7 +878,8 @@ void MainWindow::onRenameSelected()
 
     try {
         m_manager.renameAppImage(entry->id, trimmed.toStdString());
-        refreshEntries();
+        m_model->entryChanged(entry->id);
+        m_listView->scrollTo(m_listView->currentIndex());
     } catch (const std::exception &error) {
         QMessageBox::critical(this, tr("Unable to rename AppImage"), QString::fromUtf8(error.what()));
     }
@@ -612,10 +893,7 @@ void MainWindow::onOpenPreferences()
     }
 
     Preferences updated = dialog.preferences();
-    if (updated.moveToStorageOnAdd == m_preferences.moveToStorageOnAdd
-        && updated.confirmRemoval == m_preferences.confirmRemoval
-        && updated.viewMode == m_preferences.viewMode
-        && updated.language == m_preferences.language) {
+    if (updated == m_preferences) {
         return;
     }
 
@@ -636,7 +914,7 @@ void MainWindow::onContextMenuRequested(const QPoint &position)
     menu.addAction(m_autostartAction);
     menu.addSeparator();
     menu.addAction(m_removeAction);
-    menu.exec(m_listWidget->viewport()->mapToGlobal(position));
+    menu.exec(m_listView->viewport()->mapToGlobal(position));
 }
 
 } // namespace appimagelauncher
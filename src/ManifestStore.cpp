@@ -0,0 +1,787 @@
+#include "AppImageManager/ManifestStore.h"
+
+#include "AppImageManager/FileDescriptor.h"
+#include "AppImageManager/MappedFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace appimagelauncher {
+
+namespace {
+
+// On-disk layout (native byte order):
+//   Header
+//   recordCount x { uint64_t numbers[numberFieldCount]; StringRef strings[stringFieldCount]; }
+//   string table (stringTableSize bytes, not NUL terminated)
+// Fields are only ever appended, so readers skip unknown trailing fields and treat
+// fields missing from older files as empty.
+constexpr char kMagic[8] = { 'A', 'I', 'M', 'M', 'N', 'F', 'S', 'T' };
+constexpr std::uint32_t kFormatVersion = 1;
+constexpr std::uint32_t kMaxFieldCount = 256;
+
+enum StringField : std::uint32_t {
+    kIdField,
+    kNameField,
+    kStoredPathField,
+    kOriginalPathField,
+    kVersionField,
+    kCategoriesField,
+    kCommentField,
+    kIconNameField,
+    kContentHashField,
+    kStringFieldCount
+};
+
+enum NumberField : std::uint32_t {
+    kFlagsField,
+    kAppImageTypeField,
+    kMachineField,
+    kPayloadOffsetField,
+    kActiveVersionField,
+    kNumberFieldCount
+};
+
+constexpr std::uint64_t kAutostartFlag = 1u << 0;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordCount;
+    std::uint32_t numberFieldCount;
+    std::uint32_t stringFieldCount;
+    std::uint64_t stringTableOffset;
+    std::uint64_t stringTableSize;
+};
+static_assert(sizeof(Header) == 40, "Manifest header layout must stay stable");
+
+struct StringRef {
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+static_assert(sizeof(StringRef) == 8, "Manifest string reference layout must stay stable");
+
+std::string_view stringField(const AppImageEntry &entry, std::uint32_t field)
+{
+    switch (field) {
+    case kIdField:
+        return entry.id;
+    case kNameField:
+        return entry.name;
+    case kStoredPathField:
+        return entry.storedPath.native();
+    case kOriginalPathField:
+        return entry.originalPath.native();
+    case kVersionField:
+        return entry.version;
+    case kCategoriesField:
+        return entry.categories;
+    case kCommentField:
+        return entry.comment;
+    case kIconNameField:
+        return entry.iconName;
+    case kContentHashField:
+        return entry.contentHash;
+    default:
+        return {};
+    }
+}
+
+void assignStringField(AppImageEntry &entry, std::uint32_t field, std::string_view value)
+{
+    switch (field) {
+    case kIdField:
+        entry.id.assign(value);
+        break;
+    case kNameField:
+        entry.name.assign(value);
+        break;
+    case kStoredPathField:
+        entry.storedPath = std::string(value);
+        break;
+    case kOriginalPathField:
+        entry.originalPath = std::string(value);
+        break;
+    case kVersionField:
+        entry.version.assign(value);
+        break;
+    case kCategoriesField:
+        entry.categories.assign(value);
+        break;
+    case kCommentField:
+        entry.comment.assign(value);
+        break;
+    case kIconNameField:
+        entry.iconName.assign(value);
+        break;
+    case kContentHashField:
+        entry.contentHash.assign(value);
+        break;
+    default:
+        break;
+    }
+}
+
+std::uint64_t numberField(const AppImageEntry &entry, std::uint32_t field)
+{
+    switch (field) {
+    case kFlagsField:
+        return entry.autostart ? kAutostartFlag : 0;
+    case kAppImageTypeField:
+        return static_cast<std::uint64_t>(entry.appImageType);
+    case kMachineField:
+        return entry.machine;
+    case kPayloadOffsetField:
+        return entry.payloadOffset;
+    case kActiveVersionField:
+        return entry.activeVersion;
+    default:
+        return 0;
+    }
+}
+
+void assignNumberField(AppImageEntry &entry, std::uint32_t field, std::uint64_t value)
+{
+    switch (field) {
+    case kFlagsField:
+        entry.autostart = (value & kAutostartFlag) != 0;
+        break;
+    case kAppImageTypeField:
+        entry.appImageType = static_cast<int>(value);
+        break;
+    case kMachineField:
+        entry.machine = static_cast<std::uint32_t>(value);
+        break;
+    case kPayloadOffsetField:
+        entry.payloadOffset = value;
+        break;
+    case kActiveVersionField:
+        entry.activeVersion = static_cast<unsigned>(value);
+        break;
+    default:
+        break;
+    }
+}
+
+template <typename T>
+T readAt(const unsigned char *data, std::size_t offset)
+{
+    T value;
+    std::memcpy(&value, data + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void append(std::string &buffer, const T &value)
+{
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+CorruptManifestError corruptManifest(const std::filesystem::path &path, const char *reason)
+{
+    return CorruptManifestError("Corrupt AppImage manifest " + path.string() + ": " + reason);
+}
+
+// Journal records are { uint32_t length; uint32_t checksum; payload[length] } where the
+// payload is an opcode followed by either a whole entry (put) or an id (erase). Replaying
+// is idempotent, so a crash between compaction and journal truncation is harmless.
+enum JournalOp : std::uint8_t {
+    kPutOp = 1,
+    kEraseOp = 2
+};
+
+constexpr std::size_t kJournalRecordHeaderSize = 2 * sizeof(std::uint32_t);
+constexpr std::uint32_t kMaxJournalRecordSize = 16u << 20;
+// The journal is folded into the base manifest once it outgrows the base (or this floor),
+// which keeps replay cost proportional to the library size.
+constexpr off_t kMinCompactionBytes = 64 * 1024;
+
+std::uint32_t checksum(std::string_view data)
+{
+    std::uint32_t hash = 2166136261u;
+    for (unsigned char ch : data) {
+        hash ^= ch;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void appendString(std::string &buffer, std::string_view value)
+{
+    append(buffer, static_cast<std::uint32_t>(value.size()));
+    buffer.append(value);
+}
+
+class PayloadReader {
+public:
+    explicit PayloadReader(std::string_view payload)
+        : m_payload(payload)
+    {
+    }
+
+    template <typename T>
+    bool read(T &value)
+    {
+        if (m_payload.size() - m_offset < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, m_payload.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string_view &value)
+    {
+        std::uint32_t length = 0;
+        if (!read(length) || m_payload.size() - m_offset < length) {
+            return false;
+        }
+        value = m_payload.substr(m_offset, length);
+        m_offset += length;
+        return true;
+    }
+
+private:
+    std::string_view m_payload;
+    std::size_t m_offset = 0;
+};
+
+std::string encodePut(const AppImageEntry &entry)
+{
+    std::string payload;
+    append(payload, static_cast<std::uint8_t>(kPutOp));
+    append(payload, static_cast<std::uint32_t>(kNumberFieldCount));
+    for (std::uint32_t field = 0; field < kNumberFieldCount; ++field) {
+        append(payload, numberField(entry, field));
+    }
+    append(payload, static_cast<std::uint32_t>(kStringFieldCount));
+    for (std::uint32_t field = 0; field < kStringFieldCount; ++field) {
+        appendString(payload, stringField(entry, field));
+    }
+    return payload;
+}
+
+std::string encodeErase(const std::string &id)
+{
+    std::string payload;
+    append(payload, static_cast<std::uint8_t>(kEraseOp));
+    appendString(payload, id);
+    return payload;
+}
+
+void appendRecord(std::string &buffer, const std::string &payload)
+{
+    append(buffer, static_cast<std::uint32_t>(payload.size()));
+    append(buffer, checksum(payload));
+    buffer.append(payload);
+}
+
+bool applyJournalPayload(EntryMap &entries, std::string_view payload)
+{
+    PayloadReader reader(payload);
+    std::uint8_t op = 0;
+    if (!reader.read(op)) {
+        return false;
+    }
+
+    if (op == kEraseOp) {
+        std::string_view id;
+        if (!reader.readString(id)) {
+            return false;
+        }
+        entries.erase(std::string(id));
+        return true;
+    }
+
+    if (op != kPutOp) {
+        return false;
+    }
+
+    AppImageEntry entry;
+    std::uint32_t count = 0;
+    if (!reader.read(count) || count > kMaxFieldCount) {
+        return false;
+    }
+    for (std::uint32_t field = 0; field < count; ++field) {
+        std::uint64_t value = 0;
+        if (!reader.read(value)) {
+            return false;
+        }
+        assignNumberField(entry, field, value);
+    }
+    if (!reader.read(count) || count > kMaxFieldCount) {
+        return false;
+    }
+    for (std::uint32_t field = 0; field < count; ++field) {
+        std::string_view value;
+        if (!reader.readString(value)) {
+            return false;
+        }
+        assignStringField(entry, field, value);
+    }
+    if (entry.id.empty()) {
+        return false;
+    }
+    entries[entry.id] = std::move(entry);
+    return true;
+}
+
+void writeAll(int fd, std::string_view data, const std::filesystem::path &path)
+{
+    while (!data.empty()) {
+        const ssize_t written = ::write(fd, data.data(), data.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw ioError("Unable to write", path);
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+    }
+}
+
+void syncDirectory(const std::filesystem::path &directory)
+{
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+// Writes to a sibling temporary file, syncs it and renames it over the target so readers
+// only ever observe the old or the new file, never a truncated one.
+void writeFileAtomically(const std::filesystem::path &path, std::string_view data)
+{
+    auto temporary = path;
+    temporary += ".tmp";
+
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw ioError("Unable to write AppImage manifest", temporary);
+    }
+    try {
+        writeAll(fd, data, temporary);
+        if (::fsync(fd) != 0) {
+            throw ioError("Unable to sync AppImage manifest", temporary);
+        }
+    } catch (...) {
+        ::close(fd);
+        ::unlink(temporary.c_str());
+        throw;
+    }
+    ::close(fd);
+
+    if (::rename(temporary.c_str(), path.c_str()) != 0) {
+        const int error = errno;
+        ::unlink(temporary.c_str());
+        errno = error;
+        throw ioError("Unable to replace AppImage manifest", path);
+    }
+    syncDirectory(path.parent_path());
+}
+
+} // namespace
+
+ManifestStore::Lock::Lock(const ManifestStore &store)
+    : m_store(&store)
+{
+    store.lock();
+}
+
+ManifestStore::Lock::Lock(Lock &&other) noexcept
+    : m_store(other.m_store)
+{
+    other.m_store = nullptr;
+}
+
+ManifestStore::Lock::~Lock()
+{
+    if (m_store) {
+        m_store->unlock();
+    }
+}
+
+ManifestStore::ManifestStore(const std::filesystem::path &baseDirectory)
+    : m_path(baseDirectory / "manifest.bin")
+    , m_journalPath(baseDirectory / "manifest.journal")
+    , m_legacyPath(baseDirectory / "manifest.tsv")
+    , m_lockPath(baseDirectory / "manifest.lock")
+{
+}
+
+ManifestStore::~ManifestStore()
+{
+    if (m_lockFd >= 0) {
+        ::close(m_lockFd);
+    }
+}
+
+bool ManifestStore::openLockFile() const
+{
+    if (m_lockFd < 0) {
+        m_lockFd = ::open(m_lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    }
+    return m_lockFd >= 0;
+}
+
+void ManifestStore::lock() const
+{
+    if (m_lockDepth > 0) {
+        ++m_lockDepth;
+        return;
+    }
+    if (!openLockFile()) {
+        throw ioError("Unable to open AppImage manifest lock", m_lockPath);
+    }
+    while (::flock(m_lockFd, LOCK_EX) != 0) {
+        if (errno != EINTR) {
+            throw ioError("Unable to lock AppImage manifest", m_lockPath);
+        }
+    }
+    m_lockDepth = 1;
+}
+
+void ManifestStore::unlock() const
+{
+    if (--m_lockDepth == 0) {
+        ::flock(m_lockFd, LOCK_UN);
+    }
+}
+
+std::uint64_t ManifestStore::generation() const
+{
+    std::uint64_t value = 0;
+    if (openLockFile() && ::pread(m_lockFd, &value, sizeof(value), 0) != static_cast<ssize_t>(sizeof(value))) {
+        value = 0;
+    }
+    return value;
+}
+
+// Only called with the lock held, so the read and the write cannot interleave with
+// another process's.
+void ManifestStore::bumpGeneration() const
+{
+    const std::uint64_t next = generation() + 1;
+    if (::pwrite(m_lockFd, &next, sizeof(next), 0) != static_cast<ssize_t>(sizeof(next))) {
+        throw ioError("Unable to update AppImage manifest generation", m_lockPath);
+    }
+}
+
+EntryMap ManifestStore::load() const
+{
+    // Loading may migrate the legacy manifest or trim a torn journal record.
+    const Lock lock(*this);
+    EntryMap entries;
+    if (std::filesystem::exists(m_path)) {
+        try {
+            entries = readBinary(m_path);
+        } catch (const CorruptManifestError &error) {
+            entries = recoverCorruptManifest(error);
+        }
+    } else if (std::filesystem::exists(m_legacyPath)) {
+        // Migrate once; the legacy file is left in place for older builds.
+        entries = readTsv(m_legacyPath);
+        writeBinary(m_path, entries);
+    }
+
+    replayJournal(entries);
+    return entries;
+}
+
+// Called with the lock held. Entries the journal does not mention since the last compaction
+// are lost unless the legacy manifest still has them.
+EntryMap ManifestStore::recoverCorruptManifest(const CorruptManifestError &error) const
+{
+    const std::string stem = m_path.string() + ".corrupt-" + std::to_string(static_cast<long long>(std::time(nullptr)));
+    std::filesystem::path aside = stem;
+    // Never replaces an earlier copy moved aside within the same second.
+    for (int suffix = 1; std::filesystem::exists(aside); ++suffix) {
+        aside = stem + "." + std::to_string(suffix);
+    }
+    if (::rename(m_path.c_str(), aside.c_str()) != 0) {
+        throw ioError("Unable to move aside corrupt AppImage manifest", m_path);
+    }
+
+    EntryMap entries;
+    const bool haveLegacy = std::filesystem::exists(m_legacyPath);
+    if (haveLegacy) {
+        entries = readTsv(m_legacyPath);
+    }
+    writeBinary(m_path, entries);
+    bumpGeneration();
+    std::cerr << "Warning: " << error.what() << "; moved it to " << aside.string() << " and rebuilt the library from "
+              << (haveLegacy ? m_legacyPath.filename().string() + " and the journal" : std::string("the journal"))
+              << std::endl;
+    return entries;
+}
+
+void ManifestStore::save(const EntryMap &entries) const
+{
+    const Lock lock(*this);
+    writeBinary(m_path, entries);
+    bumpGeneration();
+    if (::truncate(m_journalPath.c_str(), 0) != 0 && errno != ENOENT) {
+        throw ioError("Unable to reset AppImage manifest journal", m_journalPath);
+    }
+}
+
+bool ManifestStore::recordPut(const AppImageEntry &entry) const
+{
+    std::string records;
+    appendRecord(records, encodePut(entry));
+    return appendJournal(records);
+}
+
+bool ManifestStore::recordErase(const std::string &id) const
+{
+    std::string records;
+    appendRecord(records, encodeErase(id));
+    return appendJournal(records);
+}
+
+bool ManifestStore::recordChanges(const EntryMap &entries, const std::set<std::string> &ids) const
+{
+    std::string records;
+    for (const auto &id : ids) {
+        const auto it = entries.find(id);
+        appendRecord(records, it != entries.end() ? encodePut(it->second) : encodeErase(id));
+    }
+    return appendJournal(records);
+}
+
+bool ManifestStore::appendJournal(const std::string &records) const
+{
+    const Lock lock(*this);
+    const int fd = ::open(m_journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw ioError("Unable to open AppImage manifest journal", m_journalPath);
+    }
+    off_t journalSize = 0;
+    try {
+        writeAll(fd, records, m_journalPath);
+        if (::fdatasync(fd) != 0) {
+            throw ioError("Unable to sync AppImage manifest journal", m_journalPath);
+        }
+        journalSize = ::lseek(fd, 0, SEEK_END);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    bumpGeneration();
+
+    struct stat baseInfo {};
+    const off_t baseSize = ::stat(m_path.c_str(), &baseInfo) == 0 ? baseInfo.st_size : 0;
+    return journalSize > std::max(baseSize, kMinCompactionBytes);
+}
+
+void ManifestStore::replayJournal(EntryMap &entries) const
+{
+    if (!std::filesystem::exists(m_journalPath)) {
+        return;
+    }
+
+    const MappedFile journal(m_journalPath);
+    const std::string_view data = journal.view();
+    std::size_t offset = 0;
+    while (data.size() - offset >= kJournalRecordHeaderSize) {
+        const auto length = readAt<std::uint32_t>(journal.data(), offset);
+        const auto expected = readAt<std::uint32_t>(journal.data(), offset + sizeof(std::uint32_t));
+        if (length > kMaxJournalRecordSize || data.size() - offset - kJournalRecordHeaderSize < length) {
+            break;
+        }
+        const std::string_view payload = data.substr(offset + kJournalRecordHeaderSize, length);
+        if (checksum(payload) != expected || !applyJournalPayload(entries, payload)) {
+            break;
+        }
+        offset += kJournalRecordHeaderSize + length;
+    }
+
+    // Drop a record torn by a crash mid-append so later appends start on a clean boundary.
+    if (offset != data.size() && ::truncate(m_journalPath.c_str(), static_cast<off_t>(offset)) != 0) {
+        // Best effort; the torn tail is skipped again on the next load.
+    }
+}
+
+EntryMap ManifestStore::readBinary(const std::filesystem::path &path)
+{
+    const MappedFile file(path);
+    const unsigned char *data = file.data();
+    const std::size_t size = file.size();
+
+    if (size < sizeof(Header)) {
+        throw corruptManifest(path, "truncated header");
+    }
+
+    const auto header = readAt<Header>(data, 0);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw corruptManifest(path, "bad magic");
+    }
+    if (header.version == 0 || header.version > kFormatVersion) {
+        throw corruptManifest(path, "unsupported format version");
+    }
+    if (header.numberFieldCount > kMaxFieldCount || header.stringFieldCount > kMaxFieldCount) {
+        throw corruptManifest(path, "implausible field count");
+    }
+
+    const std::uint64_t recordSize = std::uint64_t(header.numberFieldCount) * sizeof(std::uint64_t)
+        + std::uint64_t(header.stringFieldCount) * sizeof(StringRef);
+    const std::uint64_t recordsEnd = sizeof(Header) + recordSize * header.recordCount;
+    if (recordsEnd > header.stringTableOffset || header.stringTableOffset > size
+        || header.stringTableSize > size - header.stringTableOffset) {
+        throw corruptManifest(path, "invalid section bounds");
+    }
+
+    const std::string_view strings(reinterpret_cast<const char *>(data + header.stringTableOffset), header.stringTableSize);
+
+    EntryMap entries;
+    for (std::uint32_t index = 0; index < header.recordCount; ++index) {
+        std::size_t offset = sizeof(Header) + static_cast<std::size_t>(recordSize) * index;
+
+        AppImageEntry entry;
+        for (std::uint32_t field = 0; field < header.numberFieldCount; ++field) {
+            assignNumberField(entry, field, readAt<std::uint64_t>(data, offset));
+            offset += sizeof(std::uint64_t);
+        }
+        for (std::uint32_t field = 0; field < header.stringFieldCount; ++field) {
+            const auto ref = readAt<StringRef>(data, offset);
+            offset += sizeof(StringRef);
+            if (ref.offset > strings.size() || ref.length > strings.size() - ref.offset) {
+                throw corruptManifest(path, "string reference out of range");
+            }
+            assignStringField(entry, field, strings.substr(ref.offset, ref.length));
+        }
+
+        if (entry.id.empty()) {
+            continue;
+        }
+        // Records are written in id order, so appending at the end is amortised O(1).
+        entries.emplace_hint(entries.end(), entry.id, std::move(entry));
+    }
+    return entries;
+}
+
+void ManifestStore::writeBinary(const std::filesystem::path &path, const EntryMap &entries)
+{
+    if (entries.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Too many entries for AppImage manifest: " + path.string());
+    }
+
+    std::string records;
+    records.reserve(entries.size() * (kNumberFieldCount * sizeof(std::uint64_t) + kStringFieldCount * sizeof(StringRef)));
+    std::string strings;
+
+    for (const auto &pair : entries) {
+        const auto &entry = pair.second;
+        for (std::uint32_t field = 0; field < kNumberFieldCount; ++field) {
+            append(records, numberField(entry, field));
+        }
+        for (std::uint32_t field = 0; field < kStringFieldCount; ++field) {
+            const std::string_view value = stringField(entry, field);
+            if (strings.size() + value.size() > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::runtime_error("AppImage manifest string table overflow: " + path.string());
+            }
+            append(records, StringRef{ static_cast<std::uint32_t>(strings.size()), static_cast<std::uint32_t>(value.size()) });
+            strings.append(value);
+        }
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kFormatVersion;
+    header.recordCount = static_cast<std::uint32_t>(entries.size());
+    header.numberFieldCount = kNumberFieldCount;
+    header.stringFieldCount = kStringFieldCount;
+    header.stringTableOffset = sizeof(Header) + records.size();
+    header.stringTableSize = strings.size();
+
+    std::string contents;
+    contents.reserve(sizeof(header) + records.size() + strings.size());
+    append(contents, header);
+    contents.append(records);
+    contents.append(strings);
+    writeFileAtomically(path, contents);
+}
+
+EntryMap ManifestStore::readTsv(const std::filesystem::path &path)
+{
+    EntryMap entries;
+    std::ifstream stream(path);
+    if (!stream.is_open()) {
+        return entries;
+    }
+
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::istringstream lineStream(line);
+        std::string id;
+        std::string name;
+        std::string storedPath;
+        std::string originalPath;
+        std::string autostartFlag;
+
+        if (!std::getline(lineStream, id, '\t')) {
+            continue;
+        }
+        if (!std::getline(lineStream, name, '\t')) {
+            continue;
+        }
+        if (!std::getline(lineStream, storedPath, '\t')) {
+            continue;
+        }
+        if (!std::getline(lineStream, originalPath, '\t')) {
+            originalPath.clear();
+        }
+        if (!std::getline(lineStream, autostartFlag, '\t')) {
+            autostartFlag.clear();
+        }
+
+        const bool autostart = autostartFlag == "1" || autostartFlag == "true" || autostartFlag == "yes";
+
+        AppImageEntry entry;
+        entry.id = id;
+        entry.name = name;
+        entry.storedPath = storedPath;
+        entry.originalPath = originalPath;
+        entry.autostart = autostart;
+        entries.emplace(entry.id, std::move(entry));
+    }
+    return entries;
+}
+
+void ManifestStore::writeTsv(const std::filesystem::path &path, const EntryMap &entries)
+{
+    std::ofstream stream(path, std::ios::trunc);
+    if (!stream.is_open()) {
+        throw std::runtime_error("Unable to write AppImage manifest: " + path.string());
+    }
+
+    for (const auto &pair : entries) {
+        const auto &entry = pair.second;
+        stream << entry.id << '\t'
+               << entry.name << '\t'
+               << entry.storedPath.string() << '\t'
+               << entry.originalPath.string() << '\t'
+               << (entry.autostart ? "1" : "0") << '\n';
+    }
+}
+
+} // namespace appimagelauncher
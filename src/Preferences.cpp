@@ -11,6 +11,7 @@ constexpr const char *kMoveToStorageKey = "moveToStorageOnAdd";
 constexpr const char *kConfirmRemovalKey = "confirmRemoval";
 constexpr const char *kViewModeKey = "viewMode";
 constexpr const char *kLanguageKey = "language";
+constexpr const char *kInboxDirectoryKey = "inboxDirectory";
 
 ViewMode decodeViewMode(int value)
 {
@@ -50,6 +51,7 @@ Preferences Preferences::load()
     prefs.confirmRemoval = settings.value(QString::fromLatin1(kConfirmRemovalKey), true).toBool();
     prefs.viewMode = decodeViewMode(settings.value(QString::fromLatin1(kViewModeKey), 0).toInt());
     prefs.language = decodeLanguage(settings.value(QString::fromLatin1(kLanguageKey), 0).toInt());
+    prefs.inboxDirectory = settings.value(QString::fromLatin1(kInboxDirectoryKey)).toString();
 
     settings.endGroup();
     return prefs;
@@ -64,6 +66,7 @@ void Preferences::save() const
     settings.setValue(QString::fromLatin1(kConfirmRemovalKey), confirmRemoval);
     settings.setValue(QString::fromLatin1(kViewModeKey), static_cast<int>(viewMode));
     settings.setValue(QString::fromLatin1(kLanguageKey), static_cast<int>(language));
+    settings.setValue(QString::fromLatin1(kInboxDirectoryKey), inboxDirectory);
 
     settings.endGroup();
     settings.sync();
@@ -0,0 +1,230 @@
+#include "AppImageManager/SearchIndex.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+namespace appimagelauncher {
+
+namespace {
+
+constexpr std::size_t kTrigramLength = 3;
+// Tombstoned documents are only dropped once they are both numerous and the majority,
+// so erasing stays O(1) amortised.
+constexpr std::size_t kMinDeadDocumentsBeforeCompaction = 64;
+
+std::uint32_t packTrigram(const std::string &text, std::size_t offset)
+{
+    return (std::uint32_t(static_cast<unsigned char>(text[offset])) << 16)
+        | (std::uint32_t(static_cast<unsigned char>(text[offset + 1])) << 8)
+        | std::uint32_t(static_cast<unsigned char>(text[offset + 2]));
+}
+
+// Trigrams spanning the field separator never occur in a query term, so they are skipped.
+std::vector<std::uint32_t> trigramsOf(const std::string &text)
+{
+    std::vector<std::uint32_t> trigrams;
+    for (std::size_t offset = 0; offset + kTrigramLength <= text.size(); ++offset) {
+        if (text[offset] == '\n' || text[offset + 1] == '\n' || text[offset + 2] == '\n') {
+            continue;
+        }
+        trigrams.push_back(packTrigram(text, offset));
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+std::vector<std::string> splitTerms(const std::string &query)
+{
+    std::vector<std::string> terms;
+    std::size_t start = 0;
+    while (start < query.size()) {
+        const std::size_t begin = query.find_first_not_of(" \t\n", start);
+        if (begin == std::string::npos) {
+            break;
+        }
+        const std::size_t end = std::min(query.find_first_of(" \t\n", begin), query.size());
+        terms.push_back(query.substr(begin, end - begin));
+        start = end;
+    }
+    return terms;
+}
+
+} // namespace
+
+void SearchIndex::rebuild(const std::vector<AppImageEntry> &entries)
+{
+    m_documents.clear();
+    m_documentById.clear();
+    m_trigrams.clear();
+    m_matches.clear();
+    m_deadDocuments = 0;
+    m_documents.reserve(entries.size());
+    m_matches.reserve(entries.size());
+    for (const auto &entry : entries) {
+        insert(entry);
+    }
+}
+
+void SearchIndex::insert(const AppImageEntry &entry)
+{
+    erase(entry.id);
+
+    const auto index = static_cast<std::uint32_t>(m_documents.size());
+    Document document;
+    document.id = entry.id;
+    document.text = normalize(entry.name) + '\n' + normalize(entry.id) + '\n' + normalize(entry.categories);
+    for (const std::uint32_t trigram : trigramsOf(document.text)) {
+        m_trigrams[trigram].push_back(index);
+    }
+
+    m_matches.push_back(documentMatches(document));
+    m_documentById.emplace(entry.id, index);
+    m_documents.push_back(std::move(document));
+}
+
+void SearchIndex::erase(const std::string &id)
+{
+    const auto it = m_documentById.find(id);
+    if (it == m_documentById.end()) {
+        return;
+    }
+
+    m_documents[it->second].alive = false;
+    m_matches[it->second] = false;
+    m_documentById.erase(it);
+    ++m_deadDocuments;
+    if (m_deadDocuments >= kMinDeadDocumentsBeforeCompaction && m_deadDocuments * 2 > m_documents.size()) {
+        compact();
+    }
+}
+
+void SearchIndex::setQuery(const std::string &query)
+{
+    const std::string normalized = normalize(query);
+    if (normalized == m_query) {
+        return;
+    }
+
+    // Every term of the previous query is a prefix of a term of an extended one, so the
+    // new matches are a subset of the old ones.
+    const bool narrowing = !m_terms.empty() && normalized.compare(0, m_query.size(), m_query) == 0;
+    m_query = normalized;
+    m_terms = splitTerms(normalized);
+
+    if (narrowing) {
+        for (std::size_t index = 0; index < m_documents.size(); ++index) {
+            if (m_matches[index]) {
+                m_matches[index] = documentMatches(m_documents[index]);
+            }
+        }
+        return;
+    }
+
+    m_matches.assign(m_documents.size(), false);
+    for (const std::uint32_t index : candidates()) {
+        const Document &document = m_documents[index];
+        m_matches[index] = document.alive && documentMatches(document);
+    }
+}
+
+bool SearchIndex::matches(const std::string &id) const
+{
+    if (m_terms.empty()) {
+        return true;
+    }
+    const auto it = m_documentById.find(id);
+    return it != m_documentById.end() && m_matches[it->second];
+}
+
+std::vector<std::string> SearchIndex::matchingIds() const
+{
+    std::vector<std::string> ids;
+    for (std::size_t index = 0; index < m_documents.size(); ++index) {
+        const Document &document = m_documents[index];
+        if (document.alive && (m_terms.empty() || m_matches[index])) {
+            ids.push_back(document.id);
+        }
+    }
+    return ids;
+}
+
+std::string SearchIndex::normalize(const std::string &value)
+{
+    std::string result = value;
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char ch) {
+        return ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch - 'A' + 'a') : static_cast<char>(ch);
+    });
+    return result;
+}
+
+bool SearchIndex::documentMatches(const Document &document) const
+{
+    return std::all_of(m_terms.begin(), m_terms.end(), [&](const std::string &term) {
+        return document.text.find(term) != std::string::npos;
+    });
+}
+
+// Intersects the posting lists of every trigram of every term long enough to have one,
+// smallest list first. Short queries fall back to all documents.
+std::vector<std::uint32_t> SearchIndex::candidates() const
+{
+    std::vector<const std::vector<std::uint32_t> *> lists;
+    for (const auto &term : m_terms) {
+        for (std::size_t offset = 0; offset + kTrigramLength <= term.size(); ++offset) {
+            const auto it = m_trigrams.find(packTrigram(term, offset));
+            if (it == m_trigrams.end()) {
+                return {};
+            }
+            lists.push_back(&it->second);
+        }
+    }
+
+    if (lists.empty()) {
+        std::vector<std::uint32_t> all(m_documents.size());
+        for (std::size_t index = 0; index < all.size(); ++index) {
+            all[index] = static_cast<std::uint32_t>(index);
+        }
+        return all;
+    }
+
+    std::sort(lists.begin(), lists.end(), [](const auto *lhs, const auto *rhs) {
+        return lhs->size() != rhs->size() ? lhs->size() < rhs->size() : std::less<>()(lhs, rhs);
+    });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+    std::vector<std::uint32_t> result = *lists.front();
+    std::vector<std::uint32_t> next;
+    for (std::size_t i = 1; i < lists.size() && !result.empty(); ++i) {
+        next.clear();
+        std::set_intersection(result.begin(), result.end(), lists[i]->begin(), lists[i]->end(), std::back_inserter(next));
+        result.swap(next);
+    }
+    return result;
+}
+
+void SearchIndex::compact()
+{
+    std::vector<Document> documents;
+    documents.swap(m_documents);
+    m_documentById.clear();
+    m_trigrams.clear();
+    m_matches.clear();
+    m_deadDocuments = 0;
+
+    for (auto &document : documents) {
+        if (!document.alive) {
+            continue;
+        }
+        // Rebuild from the stored text; the fields are already normalised.
+        const auto index = static_cast<std::uint32_t>(m_documents.size());
+        for (const std::uint32_t trigram : trigramsOf(document.text)) {
+            m_trigrams[trigram].push_back(index);
+        }
+        m_matches.push_back(documentMatches(document));
+        m_documentById.emplace(document.id, index);
+        m_documents.push_back(std::move(document));
+    }
+}
+
+} // namespace appimagelauncher
@@ -4,8 +4,12 @@
 #include <QComboBox>
 #include <QDialogButtonBox>
 #include <QEvent>
+#include <QFileDialog>
 #include <QGroupBox>
 #include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
 #include <QRadioButton>
 #include <QVBoxLayout>
 
@@ -16,6 +20,9 @@ SettingsDialog::SettingsDialog(const Preferences &preferences, QWidget *parent)
     , m_initialPreferences(preferences)
     , m_moveToStorageCheck(nullptr)
     , m_confirmRemovalCheck(nullptr)
+    , m_inboxLabel(nullptr)
+    , m_inboxEdit(nullptr)
+    , m_inboxBrowseButton(nullptr)
     , m_listViewRadio(nullptr)
     , m_gridViewRadio(nullptr)
     , m_languageCombo(nullptr)
@@ -49,6 +56,20 @@ void SettingsDialog::buildUi()
     m_confirmRemovalCheck = new QCheckBox(m_generalGroup);
     generalLayout->addWidget(m_confirmRemovalCheck);
 
+    m_inboxLabel = new QLabel(m_generalGroup);
+    generalLayout->addWidget(m_inboxLabel);
+
+    auto *inboxLayout = new QHBoxLayout();
+    inboxLayout->setSpacing(8);
+    m_inboxEdit = new QLineEdit(m_generalGroup);
+    m_inboxEdit->setClearButtonEnabled(true);
+    m_inboxLabel->setBuddy(m_inboxEdit);
+    m_inboxBrowseButton = new QPushButton(m_generalGroup);
+    connect(m_inboxBrowseButton, &QPushButton::clicked, this, &SettingsDialog::onBrowseInbox);
+    inboxLayout->addWidget(m_inboxEdit, 1);
+    inboxLayout->addWidget(m_inboxBrowseButton);
+    generalLayout->addLayout(inboxLayout);
+
     m_viewGroup = new QGroupBox(this);
     auto *viewLayout = new QHBoxLayout(m_viewGroup);
     viewLayout->setContentsMargins(12, 12, 12, 12);
@@ -87,6 +108,7 @@ void SettingsDialog::applyInitialState(const Preferences &preferences)
 {
     m_moveToStorageCheck->setChecked(preferences.moveToStorageOnAdd);
     m_confirmRemovalCheck->setChecked(preferences.confirmRemoval);
+    m_inboxEdit->setText(preferences.inboxDirectory);
 
     if (preferences.viewMode == ViewMode::Grid) {
         m_gridViewRadio->setChecked(true);
@@ -105,11 +127,20 @@ Preferences SettingsDialog::preferences() const
     Preferences prefs = m_initialPreferences;
     prefs.moveToStorageOnAdd = m_moveToStorageCheck->isChecked();
     prefs.confirmRemoval = m_confirmRemovalCheck->isChecked();
+    prefs.inboxDirectory = m_inboxEdit->text().trimmed();
     prefs.viewMode = m_gridViewRadio->isChecked() ? ViewMode::Grid : ViewMode::List;
     prefs.language = static_cast<LanguageOption>(m_languageCombo->currentData().toInt());
     return prefs;
 }
 
+void SettingsDialog::onBrowseInbox()
+{
+    const QString directory = QFileDialog::getExistingDirectory(this, tr("Select Inbox Folder"), m_inboxEdit->text());
+    if (!directory.isEmpty()) {
+        m_inboxEdit->setText(directory);
+    }
+}
+
 void SettingsDialog::changeEvent(QEvent *event)
 {
     QDialog::changeEvent(event);
@@ -131,6 +162,15 @@ void SettingsDialog::retranslateUi()
     if (m_confirmRemovalCheck) {
         m_confirmRemovalCheck->setText(tr("Ask for confirmation before removing"));
     }
+    if (m_inboxLabel) {
+        m_inboxLabel->setText(tr("Automatically import AppImages saved to:"));
+    }
+    if (m_inboxEdit) {
+        m_inboxEdit->setPlaceholderText(tr("No folder watched"));
+    }
+    if (m_inboxBrowseButton) {
+        m_inboxBrowseButton->setText(tr("Browse..."));
+    }
 
     if (m_viewGroup) {
         m_viewGroup->setTitle(tr("Layout"));
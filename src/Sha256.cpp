@@ -0,0 +1,254 @@
+#include "AppImageManager/Sha256.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define APPIMAGEMANAGER_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace appimagelauncher {
+
+namespace {
+
+constexpr std::uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+constexpr std::array<std::uint32_t, 8> kInitialState = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+inline std::uint32_t rotateRight(std::uint32_t value, unsigned bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+inline std::uint32_t loadBigEndian(const std::uint8_t *bytes)
+{
+    return (std::uint32_t(bytes[0]) << 24) | (std::uint32_t(bytes[1]) << 16) | (std::uint32_t(bytes[2]) << 8)
+        | std::uint32_t(bytes[3]);
+}
+
+void compressPortable(std::uint32_t *state, const std::uint8_t *blocks, std::size_t count)
+{
+    std::uint32_t schedule[64];
+    for (; count > 0; --count, blocks += 64) {
+        for (int i = 0; i < 16; ++i) {
+            schedule[i] = loadBigEndian(blocks + i * 4);
+        }
+        for (int i = 16; i < 64; ++i) {
+            const std::uint32_t s0 = rotateRight(schedule[i - 15], 7) ^ rotateRight(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3);
+            const std::uint32_t s1 = rotateRight(schedule[i - 2], 17) ^ rotateRight(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10);
+            schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+        }
+
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            const std::uint32_t s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+            const std::uint32_t choose = (e & f) ^ (~e & g);
+            const std::uint32_t temp1 = h + s1 + choose + kRoundConstants[i] + schedule[i];
+            const std::uint32_t s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+            const std::uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            const std::uint32_t temp2 = s0 + majority;
+            h = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#ifdef APPIMAGEMANAGER_SHA256_X86
+// SHA extensions (Goldmont, Zen and Ice Lake onwards). The state is kept in the ABEF/CDGH
+// register layout sha256rnds2 expects; each group of four rounds extends the message
+// schedule with sha256msg1/msg2.
+__attribute__((target("sha,sse4.1,ssse3"))) void compressShaNi(std::uint32_t *state, const std::uint8_t *blocks, std::size_t count)
+{
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[0]));
+    __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[4]));
+    dcba = _mm_shuffle_epi32(dcba, 0xB1);
+    hgfe = _mm_shuffle_epi32(hgfe, 0x1B);
+    __m128i abef = _mm_alignr_epi8(dcba, hgfe, 8);
+    __m128i cdgh = _mm_blend_epi16(hgfe, dcba, 0xF0);
+
+    for (; count > 0; --count, blocks += 64) {
+        const __m128i savedAbef = abef;
+        const __m128i savedCdgh = cdgh;
+        __m128i words[16];
+        for (int group = 0; group < 16; ++group) {
+            if (group < 4) {
+                words[group] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks + group * 16)), byteSwap);
+            } else {
+                const __m128i partial = _mm_add_epi32(_mm_sha256msg1_epu32(words[group - 4], words[group - 3]),
+                    _mm_alignr_epi8(words[group - 1], words[group - 2], 4));
+                words[group] = _mm_sha256msg2_epu32(partial, words[group - 1]);
+            }
+            __m128i message = _mm_add_epi32(words[group],
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(&kRoundConstants[group * 4])));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+            message = _mm_shuffle_epi32(message, 0x0E);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, message);
+        }
+        abef = _mm_add_epi32(abef, savedAbef);
+        cdgh = _mm_add_epi32(cdgh, savedCdgh);
+    }
+
+    const __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[0]), _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[4]), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+bool cpuHasShaExtensions()
+{
+    unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    const bool ssse3 = (ecx & (1u << 9)) != 0;
+    const bool sse41 = (ecx & (1u << 19)) != 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    const bool sha = (ebx & (1u << 29)) != 0;
+    return ssse3 && sse41 && sha;
+}
+#endif
+
+using CompressFunction = void (*)(std::uint32_t *, const std::uint8_t *, std::size_t);
+
+// Picked once on first use.
+CompressFunction compressFunction()
+{
+#ifdef APPIMAGEMANAGER_SHA256_X86
+    static const CompressFunction function = cpuHasShaExtensions() ? compressShaNi : compressPortable;
+    return function;
+#else
+    return compressPortable;
+#endif
+}
+
+} // namespace
+
+Sha256::Sha256()
+    : m_state(kInitialState)
+    , m_buffer {}
+{
+}
+
+void Sha256::update(const void *data, std::size_t size)
+{
+    const auto *bytes = static_cast<const std::uint8_t *>(data);
+    m_length += size;
+
+    if (m_buffered > 0) {
+        const std::size_t take = std::min(size, m_buffer.size() - m_buffered);
+        std::memcpy(m_buffer.data() + m_buffered, bytes, take);
+        m_buffered += take;
+        bytes += take;
+        size -= take;
+        if (m_buffered < m_buffer.size()) {
+            return;
+        }
+        compress(m_buffer.data(), 1);
+        m_buffered = 0;
+    }
+
+    const std::size_t blocks = size / 64;
+    if (blocks > 0) {
+        compress(bytes, blocks);
+        bytes += blocks * 64;
+        size -= blocks * 64;
+    }
+
+    if (size > 0) {
+        std::memcpy(m_buffer.data(), bytes, size);
+        m_buffered = size;
+    }
+}
+
+Sha256::Digest Sha256::finish()
+{
+    const std::uint64_t bitLength = m_length * 8;
+    const std::uint8_t padding = 0x80;
+    update(&padding, 1);
+    const std::uint8_t zero = 0;
+    while (m_buffered != 56) {
+        update(&zero, 1);
+    }
+    std::uint8_t lengthBytes[8];
+    for (int i = 0; i < 8; ++i) {
+        lengthBytes[i] = static_cast<std::uint8_t>(bitLength >> (56 - 8 * i));
+    }
+    update(lengthBytes, sizeof(lengthBytes));
+
+    Digest digest {};
+    for (std::size_t i = 0; i < m_state.size(); ++i) {
+        digest[i * 4] = static_cast<std::uint8_t>(m_state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<std::uint8_t>(m_state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<std::uint8_t>(m_state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<std::uint8_t>(m_state[i]);
+    }
+    return digest;
+}
+
+Sha256::Digest Sha256::digest(const void *data, std::size_t size)
+{
+    Sha256 hash;
+    hash.update(data, size);
+    return hash.finish();
+}
+
+std::string Sha256::toHex(const Digest &digest)
+{
+    static const char kHexDigits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(digest.size() * 2);
+    for (const std::uint8_t byte : digest) {
+        hex.push_back(kHexDigits[byte >> 4]);
+        hex.push_back(kHexDigits[byte & 0x0f]);
+    }
+    return hex;
+}
+
+const char *Sha256::implementation()
+{
+#ifdef APPIMAGEMANAGER_SHA256_X86
+    if (compressFunction() == compressShaNi) {
+        return "sha-ni";
+    }
+#endif
+    return "portable";
+}
+
+void Sha256::compress(const std::uint8_t *blocks, std::size_t count)
+{
+    compressFunction()(m_state.data(), blocks, count);
+}
+
+} // namespace appimagelauncher
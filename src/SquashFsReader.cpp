@@ -0,0 +1,610 @@
+#include "AppImageManager/SquashFsReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <lzma.h>
+#include <zlib.h>
+
+#ifdef APPIMAGEMANAGER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace appimagelauncher {
+
+namespace {
+
+// SquashFS 4.0 layout, always little endian. Table positions in the superblock are relative
+// to the start of the payload; metadata (inodes, directories, fragment entries) is stored in
+// blocks of at most 8 KiB, each preceded by a 16-bit length word.
+constexpr std::uint32_t kSquashFsMagic = 0x73717368;
+constexpr std::size_t kSuperblockSize = 96;
+constexpr std::size_t kMetadataBlockSize = 8192;
+constexpr std::uint16_t kMetadataUncompressed = 0x8000;
+constexpr std::uint32_t kDataBlockUncompressed = 1u << 24;
+constexpr std::uint32_t kDataBlockSizeMask = kDataBlockUncompressed - 1;
+constexpr std::uint32_t kNoFragment = 0xffffffff;
+constexpr std::size_t kFragmentEntriesPerBlock = kMetadataBlockSize / 16;
+constexpr std::size_t kMaxDirectoryHeaderEntries = 256;
+constexpr std::size_t kMaxSymlinkTarget = 4096;
+constexpr int kMaxSymlinkDepth = 16;
+// Files are read into memory whole; anything above this is not a resource we look for.
+constexpr std::uint64_t kMaxFileSize = 256ull * 1024 * 1024;
+
+enum InodeType : std::uint16_t {
+    kBasicDirectory = 1,
+    kBasicFile = 2,
+    kBasicSymlink = 3,
+    kExtendedDirectory = 8,
+    kExtendedFile = 9,
+    kExtendedSymlink = 10
+};
+
+enum Compression : std::uint16_t {
+    kGzip = 1,
+    kLzma = 2,
+    kLzo = 3,
+    kXz = 4,
+    kLz4 = 5,
+    kZstd = 6
+};
+
+template<typename T>
+T readLe(const unsigned char *data)
+{
+    T value = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        value |= static_cast<T>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+std::uint64_t readElf(const unsigned char *data, std::size_t bytes, bool bigEndian)
+{
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < bytes; ++i) {
+        const std::size_t index = bigEndian ? i : bytes - 1 - i;
+        value = (value << 8) | data[index];
+    }
+    return value;
+}
+
+bool isDirectory(std::uint16_t type)
+{
+    return type == kBasicDirectory || type == kExtendedDirectory;
+}
+
+bool isFile(std::uint16_t type)
+{
+    return type == kBasicFile || type == kExtendedFile;
+}
+
+bool isSymlink(std::uint16_t type)
+{
+    return type == kBasicSymlink || type == kExtendedSymlink;
+}
+
+[[noreturn]] void corruptImage(const std::string &detail)
+{
+    throw std::runtime_error("Corrupt SquashFS payload: " + detail);
+}
+
+std::vector<std::string> splitPath(const std::string &path)
+{
+    std::vector<std::string> components;
+    std::size_t start = 0;
+    while (start <= path.size()) {
+        const std::size_t end = std::min(path.find('/', start), path.size());
+        if (end > start) {
+            components.push_back(path.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return components;
+}
+
+} // namespace
+
+SquashFsReader::SquashFsReader(const std::filesystem::path &appImagePath)
+    : m_file(appImagePath)
+{
+    const auto offset = elfPayloadOffset(m_file.data(), m_file.size());
+    if (!offset) {
+        throw std::runtime_error(appImagePath.string() + " is not an ELF executable");
+    }
+    m_payloadOffset = *offset;
+    if (m_file.size() - m_payloadOffset < kSuperblockSize
+        || readLe<std::uint32_t>(m_file.data() + m_payloadOffset) != kSquashFsMagic) {
+        throw std::runtime_error(appImagePath.string() + " has no SquashFS payload");
+    }
+
+    const unsigned char *block = m_file.data() + m_payloadOffset;
+    m_superblock.inodeCount = readLe<std::uint32_t>(block + 4);
+    m_superblock.blockSize = readLe<std::uint32_t>(block + 12);
+    m_superblock.fragmentCount = readLe<std::uint32_t>(block + 16);
+    m_superblock.compression = readLe<std::uint16_t>(block + 20);
+    const std::uint16_t blockLog = readLe<std::uint16_t>(block + 22);
+    m_superblock.flags = readLe<std::uint16_t>(block + 24);
+    const std::uint16_t versionMajor = readLe<std::uint16_t>(block + 28);
+    m_superblock.rootInode = readLe<std::uint64_t>(block + 32);
+    m_superblock.bytesUsed = readLe<std::uint64_t>(block + 40);
+    m_superblock.inodeTableStart = readLe<std::uint64_t>(block + 64);
+    m_superblock.directoryTableStart = readLe<std::uint64_t>(block + 72);
+    m_superblock.fragmentTableStart = readLe<std::uint64_t>(block + 80);
+
+    if (versionMajor != 4) {
+        throw std::runtime_error("Unsupported SquashFS version " + std::to_string(versionMajor));
+    }
+    if (blockLog < 12 || blockLog > 20 || m_superblock.blockSize != (1u << blockLog)) {
+        corruptImage("invalid block size");
+    }
+    if (m_superblock.bytesUsed > m_file.size() - m_payloadOffset) {
+        corruptImage("payload is truncated");
+    }
+
+    switch (m_superblock.compression) {
+    case kGzip:
+    case kLzma:
+    case kXz:
+#ifdef APPIMAGEMANAGER_HAVE_ZSTD
+    case kZstd:
+#endif
+        break;
+    default:
+        throw std::runtime_error("Unsupported SquashFS compression " + std::to_string(m_superblock.compression));
+    }
+}
+
+std::optional<std::uint64_t> SquashFsReader::elfPayloadOffset(const unsigned char *data, std::size_t size)
+{
+    return elfPayloadOffset(data, size, size);
+}
+
+std::optional<std::uint64_t> SquashFsReader::elfPayloadOffset(const unsigned char *data, std::size_t size,
+                                                              std::uint64_t fileSize)
+{
+    constexpr std::size_t kElf32HeaderSize = 52;
+    constexpr std::size_t kElf64HeaderSize = 64;
+    if (size < kElf32HeaderSize || std::memcmp(data, "\x7f" "ELF", 4) != 0) {
+        return std::nullopt;
+    }
+
+    const unsigned char elfClass = data[4];
+    const unsigned char encoding = data[5];
+    if (encoding != 1 && encoding != 2) {
+        return std::nullopt;
+    }
+    const bool bigEndian = encoding == 2;
+
+    std::uint64_t sectionHeaderOffset = 0;
+    std::uint64_t sectionHeaderSize = 0;
+    std::uint64_t sectionHeaderCount = 0;
+    if (elfClass == 1) {
+        sectionHeaderOffset = readElf(data + 0x20, 4, bigEndian);
+        sectionHeaderSize = readElf(data + 0x2e, 2, bigEndian);
+        sectionHeaderCount = readElf(data + 0x30, 2, bigEndian);
+    } else if (elfClass == 2 && size >= kElf64HeaderSize) {
+        sectionHeaderOffset = readElf(data + 0x28, 8, bigEndian);
+        sectionHeaderSize = readElf(data + 0x3a, 2, bigEndian);
+        sectionHeaderCount = readElf(data + 0x3c, 2, bigEndian);
+    } else {
+        return std::nullopt;
+    }
+
+    if (sectionHeaderOffset > fileSize) {
+        return std::nullopt;
+    }
+    const std::uint64_t end = sectionHeaderOffset + sectionHeaderSize * sectionHeaderCount;
+    if (end > fileSize) {
+        return std::nullopt;
+    }
+    return end;
+}
+
+std::vector<SquashFsReader::DirectoryEntry> SquashFsReader::listDirectory(const std::string &path) const
+{
+    std::vector<DirectoryEntry> entries;
+    const auto directory = resolve(path, true);
+    if (!directory || !isDirectory(directory->type)) {
+        return entries;
+    }
+
+    for (auto &entry : readDirectory(*directory)) {
+        entries.push_back(std::move(entry.first));
+    }
+    return entries;
+}
+
+std::optional<std::string> SquashFsReader::readFile(const std::string &path) const
+{
+    const auto inode = resolve(path, true);
+    if (!inode || !isFile(inode->type)) {
+        return std::nullopt;
+    }
+    if (inode->fileSize > kMaxFileSize) {
+        throw std::runtime_error(path + " is too large to read from the SquashFS payload");
+    }
+
+    std::string content;
+    content.reserve(static_cast<std::size_t>(inode->fileSize));
+    MetadataCursor cursor = inode->blockList;
+    std::uint64_t position = inode->blocksStart;
+    for (std::uint64_t i = 0; i < inode->blockCount; ++i) {
+        unsigned char word[4];
+        readMetadata(m_superblock.inodeTableStart, cursor, word, sizeof(word));
+        const std::uint32_t entry = readLe<std::uint32_t>(word);
+        const std::uint32_t storedSize = entry & kDataBlockSizeMask;
+        const std::size_t expected = static_cast<std::size_t>(
+            std::min<std::uint64_t>(m_superblock.blockSize, inode->fileSize - content.size()));
+
+        if (storedSize == 0) {
+            // Sparse block.
+            content.append(expected, '\0');
+            continue;
+        }
+
+        const unsigned char *data = at(position, storedSize);
+        if (entry & kDataBlockUncompressed) {
+            content.append(reinterpret_cast<const char *>(data), storedSize);
+        } else {
+            content += decompress(data, storedSize, m_superblock.blockSize);
+        }
+        position += storedSize;
+        if (content.size() > inode->fileSize) {
+            corruptImage("data block overruns " + path);
+        }
+    }
+
+    if (inode->fragment != kNoFragment) {
+        const std::string fragment = readFragment(inode->fragment);
+        const std::uint64_t tail = inode->fileSize - content.size();
+        if (inode->fragmentOffset > fragment.size() || tail > fragment.size() - inode->fragmentOffset) {
+            corruptImage("fragment overruns " + path);
+        }
+        content.append(fragment, inode->fragmentOffset, static_cast<std::size_t>(tail));
+    }
+
+    if (content.size() != inode->fileSize) {
+        corruptImage("size mismatch for " + path);
+    }
+    return content;
+}
+
+std::optional<std::string> SquashFsReader::readLink(const std::string &path) const
+{
+    const auto inode = resolve(path, false);
+    if (!inode || !isSymlink(inode->type)) {
+        return std::nullopt;
+    }
+    return inode->target;
+}
+
+const unsigned char *SquashFsReader::at(std::uint64_t position, std::uint64_t length) const
+{
+    if (position > m_superblock.bytesUsed || length > m_superblock.bytesUsed - position) {
+        corruptImage("reference past the end of the payload");
+    }
+    return m_file.data() + m_payloadOffset + position;
+}
+
+std::string SquashFsReader::decompress(const unsigned char *data, std::size_t size, std::size_t capacity) const
+{
+    std::string output(capacity, '\0');
+    auto *out = reinterpret_cast<unsigned char *>(output.data());
+
+    switch (m_superblock.compression) {
+    case kGzip: {
+        uLongf length = static_cast<uLongf>(capacity);
+        if (::uncompress(out, &length, data, static_cast<uLong>(size)) != Z_OK) {
+            corruptImage("gzip block does not decompress");
+        }
+        output.resize(length);
+        return output;
+    }
+    case kXz: {
+        std::uint64_t memoryLimit = std::numeric_limits<std::uint64_t>::max();
+        std::size_t inPosition = 0;
+        std::size_t outPosition = 0;
+        if (::lzma_stream_buffer_decode(&memoryLimit, 0, nullptr, data, &inPosition, size, out, &outPosition, capacity)
+            != LZMA_OK) {
+            corruptImage("xz block does not decompress");
+        }
+        output.resize(outPosition);
+        return output;
+    }
+    case kLzma: {
+        lzma_stream stream = LZMA_STREAM_INIT;
+        if (::lzma_alone_decoder(&stream, std::numeric_limits<std::uint64_t>::max()) != LZMA_OK) {
+            corruptImage("lzma decoder unavailable");
+        }
+        stream.next_in = data;
+        stream.avail_in = size;
+        stream.next_out = out;
+        stream.avail_out = capacity;
+        const lzma_ret result = ::lzma_code(&stream, LZMA_FINISH);
+        const std::size_t produced = capacity - stream.avail_out;
+        ::lzma_end(&stream);
+        if (result != LZMA_STREAM_END && result != LZMA_OK) {
+            corruptImage("lzma block does not decompress");
+        }
+        output.resize(produced);
+        return output;
+    }
+#ifdef APPIMAGEMANAGER_HAVE_ZSTD
+    case kZstd: {
+        const std::size_t length = ::ZSTD_decompress(out, capacity, data, size);
+        if (::ZSTD_isError(length)) {
+            corruptImage("zstd block does not decompress");
+        }
+        output.resize(length);
+        return output;
+    }
+#endif
+    default:
+        corruptImage("unsupported compression");
+    }
+}
+
+const SquashFsReader::MetadataBlock &SquashFsReader::metadataBlock(std::uint64_t position) const
+{
+    const auto cached = m_metadataCache.find(position);
+    if (cached != m_metadataCache.end()) {
+        return cached->second;
+    }
+
+    const std::uint16_t header = readLe<std::uint16_t>(at(position, 2));
+    const std::size_t storedSize = header & ~kMetadataUncompressed;
+    if (storedSize == 0 || storedSize > kMetadataBlockSize) {
+        corruptImage("invalid metadata block");
+    }
+
+    const unsigned char *data = at(position + 2, storedSize);
+    MetadataBlock block;
+    block.storedSize = 2 + storedSize;
+    if (header & kMetadataUncompressed) {
+        block.data.assign(reinterpret_cast<const char *>(data), storedSize);
+    } else {
+        block.data = decompress(data, storedSize, kMetadataBlockSize);
+    }
+    return m_metadataCache.emplace(position, std::move(block)).first->second;
+}
+
+void SquashFsReader::readMetadata(std::uint64_t tableStart, MetadataCursor &cursor, void *out, std::size_t length) const
+{
+    auto *target = static_cast<char *>(out);
+    while (length > 0) {
+        const MetadataBlock &block = metadataBlock(tableStart + cursor.block);
+        if (cursor.offset >= block.data.size()) {
+            if (cursor.offset > block.data.size()) {
+                corruptImage("metadata offset past the end of its block");
+            }
+            cursor.block += block.storedSize;
+            cursor.offset = 0;
+            continue;
+        }
+
+        const std::size_t chunk = std::min(length, block.data.size() - cursor.offset);
+        std::memcpy(target, block.data.data() + cursor.offset, chunk);
+        target += chunk;
+        length -= chunk;
+        cursor.offset += chunk;
+    }
+}
+
+SquashFsReader::Inode SquashFsReader::readInode(std::uint64_t reference) const
+{
+    MetadataCursor cursor;
+    cursor.block = reference >> 16;
+    cursor.offset = reference & 0xffff;
+
+    unsigned char header[16];
+    readMetadata(m_superblock.inodeTableStart, cursor, header, sizeof(header));
+
+    Inode inode;
+    inode.type = readLe<std::uint16_t>(header);
+    inode.fragment = kNoFragment;
+    switch (inode.type) {
+    case kBasicDirectory: {
+        unsigned char body[16];
+        readMetadata(m_superblock.inodeTableStart, cursor, body, sizeof(body));
+        inode.directoryBlock = readLe<std::uint32_t>(body);
+        inode.directorySize = readLe<std::uint16_t>(body + 8);
+        inode.directoryOffset = readLe<std::uint16_t>(body + 10);
+        break;
+    }
+    case kExtendedDirectory: {
+        unsigned char body[24];
+        readMetadata(m_superblock.inodeTableStart, cursor, body, sizeof(body));
+        inode.directorySize = readLe<std::uint32_t>(body + 4);
+        inode.directoryBlock = readLe<std::uint32_t>(body + 8);
+        inode.directoryOffset = readLe<std::uint16_t>(body + 18);
+        break;
+    }
+    case kBasicFile:
+    case kExtendedFile: {
+        if (inode.type == kBasicFile) {
+            unsigned char body[16];
+            readMetadata(m_superblock.inodeTableStart, cursor, body, sizeof(body));
+            inode.blocksStart = readLe<std::uint32_t>(body);
+            inode.fragment = readLe<std::uint32_t>(body + 4);
+            inode.fragmentOffset = readLe<std::uint32_t>(body + 8);
+            inode.fileSize = readLe<std::uint32_t>(body + 12);
+        } else {
+            unsigned char body[40];
+            readMetadata(m_superblock.inodeTableStart, cursor, body, sizeof(body));
+            inode.blocksStart = readLe<std::uint64_t>(body);
+            inode.fileSize = readLe<std::uint64_t>(body + 8);
+            inode.fragment = readLe<std::uint32_t>(body + 28);
+            inode.fragmentOffset = readLe<std::uint32_t>(body + 32);
+        }
+        inode.blockList = cursor;
+        inode.blockCount = inode.fragment == kNoFragment
+            ? (inode.fileSize + m_superblock.blockSize - 1) / m_superblock.blockSize
+            : inode.fileSize / m_superblock.blockSize;
+        break;
+    }
+    case kBasicSymlink:
+    case kExtendedSymlink: {
+        unsigned char body[8];
+        readMetadata(m_superblock.inodeTableStart, cursor, body, sizeof(body));
+        const std::uint32_t targetSize = readLe<std::uint32_t>(body + 4);
+        if (targetSize > kMaxSymlinkTarget) {
+            corruptImage("symlink target too long");
+        }
+        inode.target.resize(targetSize);
+        readMetadata(m_superblock.inodeTableStart, cursor, inode.target.data(), targetSize);
+        break;
+    }
+    default:
+        // Devices, fifos and sockets carry nothing we read.
+        break;
+    }
+    return inode;
+}
+
+std::vector<std::pair<SquashFsReader::DirectoryEntry, std::uint64_t>> SquashFsReader::readDirectory(
+    const Inode &directory) const
+{
+    std::vector<std::pair<DirectoryEntry, std::uint64_t>> entries;
+    // The stored size counts the implicit "." and ".." entries as three extra bytes.
+    if (directory.directorySize <= 3) {
+        return entries;
+    }
+
+    MetadataCursor cursor;
+    cursor.block = directory.directoryBlock;
+    cursor.offset = directory.directoryOffset;
+    std::size_t remaining = directory.directorySize - 3;
+    while (remaining > 0) {
+        unsigned char header[12];
+        if (remaining < sizeof(header)) {
+            corruptImage("truncated directory listing");
+        }
+        readMetadata(m_superblock.directoryTableStart, cursor, header, sizeof(header));
+        remaining -= sizeof(header);
+        const std::size_t count = readLe<std::uint32_t>(header) + std::size_t(1);
+        const std::uint32_t inodeBlock = readLe<std::uint32_t>(header + 4);
+        if (count > kMaxDirectoryHeaderEntries) {
+            corruptImage("oversized directory header");
+        }
+
+        for (std::size_t i = 0; i < count; ++i) {
+            unsigned char fields[8];
+            if (remaining < sizeof(fields)) {
+                corruptImage("truncated directory entry");
+            }
+            readMetadata(m_superblock.directoryTableStart, cursor, fields, sizeof(fields));
+            remaining -= sizeof(fields);
+            const std::uint16_t offset = readLe<std::uint16_t>(fields);
+            const std::uint16_t type = readLe<std::uint16_t>(fields + 4);
+            const std::size_t nameSize = readLe<std::uint16_t>(fields + 6) + std::size_t(1);
+            if (remaining < nameSize) {
+                corruptImage("truncated directory entry name");
+            }
+
+            DirectoryEntry entry;
+            entry.name.resize(nameSize);
+            readMetadata(m_superblock.directoryTableStart, cursor, entry.name.data(), nameSize);
+            remaining -= nameSize;
+            entry.type = isDirectory(type) ? EntryType::Directory
+                : isFile(type)             ? EntryType::File
+                : isSymlink(type)          ? EntryType::Symlink
+                                           : EntryType::Other;
+            entries.emplace_back(std::move(entry), (std::uint64_t(inodeBlock) << 16) | offset);
+        }
+    }
+    return entries;
+}
+
+std::optional<SquashFsReader::Inode> SquashFsReader::lookup(const Inode &directory, const std::string &name) const
+{
+    for (const auto &entry : readDirectory(directory)) {
+        if (entry.first.name == name) {
+            return readInode(entry.second);
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<SquashFsReader::Inode> SquashFsReader::resolve(const std::string &path, bool followFinalSymlink) const
+{
+    std::vector<std::string> remaining = splitPath(path);
+    std::reverse(remaining.begin(), remaining.end());
+
+    const Inode root = readInode(m_superblock.rootInode);
+    std::vector<Inode> parents;
+    Inode current = root;
+    int links = 0;
+    while (!remaining.empty()) {
+        const std::string name = std::move(remaining.back());
+        remaining.pop_back();
+        if (!isDirectory(current.type)) {
+            return std::nullopt;
+        }
+        if (name == ".") {
+            continue;
+        }
+        if (name == "..") {
+            if (!parents.empty()) {
+                current = std::move(parents.back());
+                parents.pop_back();
+            }
+            continue;
+        }
+
+        auto child = lookup(current, name);
+        if (!child) {
+            return std::nullopt;
+        }
+        if (isSymlink(child->type) && (!remaining.empty() || followFinalSymlink)) {
+            if (++links > kMaxSymlinkDepth) {
+                return std::nullopt;
+            }
+            // Absolute targets are taken relative to the image root, as the AppImage runtime
+            // mounts the payload somewhere arbitrary.
+            if (!child->target.empty() && child->target.front() == '/') {
+                current = root;
+                parents.clear();
+            }
+            const auto target = splitPath(child->target);
+            remaining.insert(remaining.end(), target.rbegin(), target.rend());
+            continue;
+        }
+        if (remaining.empty()) {
+            return child;
+        }
+        parents.push_back(std::move(current));
+        current = std::move(*child);
+    }
+    return current;
+}
+
+std::string SquashFsReader::readFragment(std::uint32_t index) const
+{
+    if (index >= m_superblock.fragmentCount) {
+        corruptImage("fragment index out of range");
+    }
+
+    // The fragment table is an array of metadata block positions, each block holding 512
+    // 16-byte entries { u64 start; u32 size; u32 unused; }.
+    const std::uint64_t blockPosition
+        = readLe<std::uint64_t>(at(m_superblock.fragmentTableStart + 8 * (index / kFragmentEntriesPerBlock), 8));
+    MetadataCursor cursor;
+    cursor.block = blockPosition;
+    cursor.offset = (index % kFragmentEntriesPerBlock) * 16;
+    unsigned char entry[16];
+    readMetadata(0, cursor, entry, sizeof(entry));
+
+    const std::uint64_t start = readLe<std::uint64_t>(entry);
+    const std::uint32_t sizeField = readLe<std::uint32_t>(entry + 8);
+    const std::uint32_t storedSize = sizeField & kDataBlockSizeMask;
+    const unsigned char *data = at(start, storedSize);
+    if (sizeField & kDataBlockUncompressed) {
+        return std::string(reinterpret_cast<const char *>(data), storedSize);
+    }
+    return decompress(data, storedSize, m_superblock.blockSize);
+}
+
+} // namespace appimagelauncher
@@ -0,0 +1,294 @@
+#include "AppImageManager/StorageReconciler.h"
+
+#include "AppImageManager/AppImageValidator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+namespace appimagelauncher {
+
+namespace {
+
+constexpr std::size_t kProgressInterval = 256;
+// See AppImageManager::versionsDirectory() and AppImageManager::autostartDesktopPath().
+constexpr const char *kVersionsDirectoryName = ".versions";
+const std::string kAutostartPrefix = "appimagemanager-";
+const std::string kAutostartSuffix = ".desktop";
+
+struct DirectoryCloser {
+    void operator()(DIR *directory) const { ::closedir(directory); }
+};
+
+bool startsWith(const std::string &value, const std::string &prefix)
+{
+    return value.size() >= prefix.size() && value.compare(0, prefix.size(), prefix) == 0;
+}
+
+bool endsWith(const std::string &value, const std::string &suffix)
+{
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Calls visit(name, info) for each entry of directory in directory order, without following
+// symlinks, until it returns false. Returns false when the directory cannot be opened.
+template <typename Visit>
+bool walkDirectory(const std::filesystem::path &directory, Visit visit)
+{
+    const std::unique_ptr<DIR, DirectoryCloser> handle(::opendir(directory.c_str()));
+    if (!handle) {
+        return false;
+    }
+    const int fd = ::dirfd(handle.get());
+    while (const dirent *item = ::readdir(handle.get())) {
+        const std::string name = item->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        struct stat info {};
+        if (::fstatat(fd, item->d_name, &info, AT_SYMLINK_NOFOLLOW) == 0 && !visit(name, info)) {
+            break;
+        }
+    }
+    return true;
+}
+
+// The process that owns a ".<name>.<pid>.part" file from the import engine or a
+// ".<name>.<pid>.update" file from an update; 0 for other names.
+pid_t temporaryOwner(const std::string &name)
+{
+    std::string rest;
+    if (name.size() > 1 && name[0] == '.' && endsWith(name, ".part")) {
+        rest = name.substr(0, name.size() - 5);
+    } else if (name.size() > 1 && name[0] == '.' && endsWith(name, ".update")) {
+        rest = name.substr(0, name.size() - 7);
+    } else {
+        return 0;
+    }
+    const std::size_t dot = rest.rfind('.');
+    if (dot == std::string::npos || dot == 0 || dot + 1 == rest.size() || rest.size() - dot > 11
+        || !std::all_of(rest.begin() + dot + 1, rest.end(), [](unsigned char ch) { return std::isdigit(ch); })) {
+        return 0;
+    }
+    return static_cast<pid_t>(std::stol(rest.substr(dot + 1)));
+}
+
+bool processExists(pid_t pid)
+{
+    return ::kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+// Space deleting the file frees: nothing while another name keeps its inode.
+std::uint64_t ownedBytes(const struct stat &info)
+{
+    return info.st_nlink == 1 ? static_cast<std::uint64_t>(info.st_blocks) * 512 : 0;
+}
+
+class StorageScan {
+public:
+    StorageScan(StorageReport &report, const StorageScanProgress &progress, std::time_t cutoff)
+        : m_report(report)
+        , m_progress(progress)
+        , m_cutoff(cutoff)
+    {
+    }
+
+    void add(StorageIssueKind kind, std::string id, std::filesystem::path path, std::uint64_t bytes = 0,
+        std::string error = {})
+    {
+        m_report.issues.push_back({ kind, std::move(id), std::move(path), bytes, std::move(error) });
+    }
+
+    // Counts a file; false once the scan is cancelled.
+    bool counted()
+    {
+        ++m_report.filesScanned;
+        if (m_progress && m_report.filesScanned % kProgressInterval == 0 && !m_progress(m_report.filesScanned)) {
+            m_report.cancelled = true;
+        }
+        return !m_report.cancelled;
+    }
+
+    // A regular file in storage or in a versions directory that no entry points at.
+    void checkUnknownFile(const std::filesystem::path &path, const std::string &name, const struct stat &info)
+    {
+        if (const pid_t owner = temporaryOwner(name)) {
+            if (!processExists(owner)) {
+                add(StorageIssueKind::StaleTemporary, {}, path, ownedBytes(info));
+            }
+            return;
+        }
+        if (info.st_ctime > m_cutoff) {
+            return;
+        }
+        // Only exist while a version switch or dedupe() holds the manifest lock.
+        if (endsWith(name, ".version") || endsWith(name, ".dedupe")) {
+            add(StorageIssueKind::StaleTemporary, {}, path, ownedBytes(info));
+            return;
+        }
+        try {
+            validateAppImage(path);
+            add(StorageIssueKind::UntrackedAppImage, {}, path, ownedBytes(info));
+        } catch (const std::exception &error) {
+            add(StorageIssueKind::InvalidFile, {}, path, ownedBytes(info), error.what());
+        }
+    }
+
+private:
+    StorageReport &m_report;
+    const StorageScanProgress &m_progress;
+    std::time_t m_cutoff;
+};
+
+} // namespace
+
+StorageReport scanStorage(const std::filesystem::path &storageDirectory, const std::filesystem::path &autostartDirectory,
+    const std::vector<AppImageEntry> &entries, const StorageScanProgress &progress, std::chrono::seconds gracePeriod)
+{
+    StorageReport report;
+    const auto start = std::chrono::steady_clock::now();
+    StorageScan scan(report, progress, std::time(nullptr) - static_cast<std::time_t>(gracePeriod.count()));
+
+    // Each file costs one hash lookup against these rather than a search of the entries.
+    const std::filesystem::path storage = std::filesystem::absolute(storageDirectory).lexically_normal();
+    std::unordered_map<std::string, const AppImageEntry *> entriesById;
+    std::unordered_set<std::string> storedNames;
+    entriesById.reserve(entries.size());
+    storedNames.reserve(entries.size());
+    for (const auto &entry : entries) {
+        entriesById.emplace(entry.id, &entry);
+        if (entry.normalizedStoredPath.parent_path() == storage) {
+            storedNames.insert(entry.normalizedStoredPath.filename().string());
+        }
+    }
+
+    std::unordered_set<std::string> foundNames;
+    foundNames.reserve(storedNames.size());
+    const bool readable = walkDirectory(storage, [&](const std::string &name, const struct stat &info) {
+        if (storedNames.count(name) != 0) {
+            foundNames.insert(name);
+        } else if (S_ISREG(info.st_mode)) {
+            scan.checkUnknownFile(storage / name, name, info);
+        }
+        return scan.counted();
+    });
+    if (!readable) {
+        throw std::runtime_error("Unable to read " + storage.string() + ": " + std::strerror(errno));
+    }
+
+    const std::filesystem::path versionsRoot = storage / kVersionsDirectoryName;
+    walkDirectory(versionsRoot, [&](const std::string &name, const struct stat &info) {
+        if (!S_ISDIR(info.st_mode)) {
+            return scan.counted();
+        }
+        const std::filesystem::path directory = versionsRoot / name;
+        if (entriesById.count(name) == 0) {
+            std::uint64_t bytes = 0;
+            walkDirectory(directory, [&](const std::string &, const struct stat &file) {
+                bytes += S_ISREG(file.st_mode) ? ownedBytes(file) : 0;
+                return scan.counted();
+            });
+            scan.add(StorageIssueKind::OrphanedVersions, name, directory, bytes);
+        } else {
+            walkDirectory(directory, [&](const std::string &file, const struct stat &fileInfo) {
+                if (S_ISREG(fileInfo.st_mode) && temporaryOwner(file) != 0) {
+                    scan.checkUnknownFile(directory / file, file, fileInfo);
+                }
+                return scan.counted();
+            });
+        }
+        return !report.cancelled;
+    });
+
+    if (!report.cancelled) {
+        for (const auto &entry : entries) {
+            bool missing = false;
+            if (entry.normalizedStoredPath.parent_path() == storage) {
+                missing = foundNames.count(entry.normalizedStoredPath.filename().string()) == 0;
+            } else {
+                // An AppImage registered in place on a volume that is not mounted is not missing.
+                struct stat info {};
+                missing = ::stat(entry.storedPath.c_str(), &info) != 0 && errno == ENOENT
+                    && ::stat(entry.storedPath.parent_path().c_str(), &info) == 0;
+            }
+            if (missing) {
+                scan.add(StorageIssueKind::MissingAppImage, entry.id, entry.storedPath);
+            }
+        }
+    }
+
+    if (!report.cancelled && !autostartDirectory.empty()) {
+        std::unordered_set<std::string> autostartIds;
+        walkDirectory(autostartDirectory, [&](const std::string &name, const struct stat &info) {
+            if (S_ISREG(info.st_mode) && name.size() > kAutostartPrefix.size() + kAutostartSuffix.size()
+                && startsWith(name, kAutostartPrefix) && endsWith(name, kAutostartSuffix)) {
+                const std::string id
+                    = name.substr(kAutostartPrefix.size(), name.size() - kAutostartPrefix.size() - kAutostartSuffix.size());
+                autostartIds.insert(id);
+                const auto it = entriesById.find(id);
+                if (it == entriesById.end() || !it->second->autostart) {
+                    scan.add(StorageIssueKind::StaleAutostart, id, autostartDirectory / name, ownedBytes(info));
+                }
+            }
+            return scan.counted();
+        });
+        for (const auto &entry : entries) {
+            if (entry.autostart && autostartIds.count(entry.id) == 0) {
+                scan.add(StorageIssueKind::MissingAutostart, entry.id,
+                    autostartDirectory / (kAutostartPrefix + entry.id + kAutostartSuffix));
+            }
+        }
+    }
+
+    std::sort(report.issues.begin(), report.issues.end(), [](const StorageIssue &lhs, const StorageIssue &rhs) {
+        return std::tie(lhs.kind, lhs.path) < std::tie(rhs.kind, rhs.path);
+    });
+    for (const auto &issue : report.issues) {
+        report.reclaimableBytes += repairDeletes(issue.kind) ? issue.bytes : 0;
+    }
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+bool repairDeletes(StorageIssueKind kind)
+{
+    return kind == StorageIssueKind::InvalidFile || kind == StorageIssueKind::StaleTemporary
+        || kind == StorageIssueKind::OrphanedVersions || kind == StorageIssueKind::StaleAutostart;
+}
+
+const char *storageIssueName(StorageIssueKind kind)
+{
+    switch (kind) {
+    case StorageIssueKind::UntrackedAppImage:
+        return "untracked";
+    case StorageIssueKind::InvalidFile:
+        return "invalid";
+    case StorageIssueKind::StaleTemporary:
+        return "temporary";
+    case StorageIssueKind::OrphanedVersions:
+        return "orphaned-versions";
+    case StorageIssueKind::MissingAppImage:
+        return "missing";
+    case StorageIssueKind::StaleAutostart:
+        return "stale-autostart";
+    case StorageIssueKind::MissingAutostart:
+        return "missing-autostart";
+    }
+    return "unknown";
+}
+
+} // namespace appimagelauncher
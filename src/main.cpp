@@ -1,4 +1,8 @@
 #include "AppImageManager/AppImageManager.h"
+#include "AppImageManager/CliCommands.h"
+#include "AppImageManager/DaemonProtocol.h"
+#include "AppImageManager/LaunchPrefetcher.h"
+#include "AppImageManager/LauncherDaemon.h"
 #include "AppImageManager/MainWindow.h"
 #include "AppImageManager/Preferences.h"
 #include "AppImageManager/TranslationManager.h"
@@ -10,19 +14,52 @@
 #include <QProcess>
 #include <QString>
 
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 using appimagelauncher::AppImageEntry;
 using appimagelauncher::AppImageManager;
+using appimagelauncher::LauncherDaemon;
 using appimagelauncher::MainWindow;
 using appimagelauncher::Preferences;
 using appimagelauncher::TranslationManager;
 
 namespace {
 
+// When APPIMAGEMANAGER_TIMING is set, reports the wall time from entering main() to
+// leaving it on stderr. scripts/benchmark-startup.sh aggregates these per command.
+class StartupTimer {
+public:
+    explicit StartupTimer(std::string command)
+        : m_command(std::move(command))
+        , m_start(std::chrono::steady_clock::now())
+    {
+        const char *enabled = std::getenv("APPIMAGEMANAGER_TIMING");
+        m_enabled = enabled && *enabled != '\0';
+    }
+
+    ~StartupTimer()
+    {
+        if (!m_enabled) {
+            return;
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start);
+        std::cerr << "appimagemanager-timing\t" << m_command << '\t' << elapsed.count() << "us" << std::endl;
+    }
+
+private:
+    std::string m_command;
+    std::chrono::steady_clock::time_point m_start;
+    bool m_enabled = false;
+};
+
 void configureApplicationMetadata()
 {
     QCoreApplication::setOrganizationName(QStringLiteral("AppImageManager"));
@@ -35,112 +72,38 @@ void configureApplicationMetadata()
 #endif
 }
 
-void printUsage()
-{
-    std::cout << "AppImage Manager\n"
-              << "Usage:\n"
-              << "  appimagemanager                # Launch the graphical interface\n"
-              << "  appimagemanager add <path>     # Add an AppImage and move it under management\n"
-              << "  appimagemanager remove <id>    # Remove a managed AppImage\n"
-              << "  appimagemanager list           # List all managed AppImages\n"
-              << "  appimagemanager autostart <id> <on|off>  # Enable or disable autostart for an AppImage\n"
-              << "  appimagemanager open <target>  # Open AppImage by id or path (prompts when new)\n"
-              << "  appimagemanager storage-dir    # Print the dedicated storage directory\n"
-              << "  appimagemanager manifest       # Print the manifest file path\n";
-}
-
-int handleCliCommand(int argc, char *argv[])
+// Hands open/list/search/autostart to a running daemon. Returns the exit code when the daemon
+// handled the command, or std::nullopt when it should be handled in-process.
+std::optional<int> forwardToDaemon(int argc, char *argv[])
 {
-    configureApplicationMetadata();
-    QCoreApplication app(argc, argv);
-
-    if (argc < 2) {
-        printUsage();
-        return 0;
-    }
-
     const std::string command = argv[1];
-    AppImageManager manager;
-
-    try {
-        if (command == "add") {
-            if (argc < 3) {
-                std::cerr << "Missing AppImage path for add command" << std::endl;
-                return 1;
-            }
-            const std::filesystem::path path = argv[2];
-            const auto entry = manager.addAppImage(path, true);
-            std::cout << "Added AppImage: " << entry.id << " (" << entry.storedPath << ")" << std::endl;
-            return 0;
-        }
-
-        if (command == "remove") {
-            if (argc < 3) {
-                std::cerr << "Missing AppImage id" << std::endl;
-                return 1;
-            }
-            manager.removeAppImage(argv[2]);
-            std::cout << "Removed AppImage: " << argv[2] << std::endl;
-            return 0;
-        }
-
-        if (command == "list") {
-            const auto entries = manager.entries();
-            for (const auto &entry : entries) {
-                std::cout << entry.id << "\t" << entry.name << "\t" << entry.storedPath
-                          << "\t" << (entry.autostart ? "autostart" : "") << std::endl;
-            }
-            return 0;
-        }
-
-        if (command == "autostart") {
-            if (argc < 4) {
-                std::cerr << "Usage: appimagemanager autostart <id> <on|off>" << std::endl;
-                return 1;
-            }
-            const std::string id = argv[2];
-            const std::string state = argv[3];
-            bool enable;
-            if (state == "on" || state == "enable" || state == "true") {
-                enable = true;
-            } else if (state == "off" || state == "disable" || state == "false") {
-                enable = false;
-            } else {
-                std::cerr << "Unknown autostart state: " << state << std::endl;
-                return 1;
-            }
-
-            manager.setAutostart(id, enable);
-            std::cout << (enable ? "Enabled" : "Disabled") << " autostart for " << id << std::endl;
-            return 0;
-        }
-
-        if (command == "storage-dir") {
-            std::cout << manager.storageDirectory() << std::endl;
-            return 0;
-        }
-
-        if (command == "manifest") {
-            std::cout << manager.manifestPath() << std::endl;
-            return 0;
-        }
-
-        if (command == "open") {
-            // Fallback to GUI-enabled handler for prompt support
-            return -1;
+    if (command != "open" && command != "list" && command != "search" && command != "autostart") {
+        return std::nullopt;
+    }
+    if (const char *disabled = std::getenv("APPIMAGEMANAGER_NO_DAEMON")) {
+        if (*disabled != '\0') {
+            return std::nullopt;
         }
+    }
 
-        if (command == "help") {
-            printUsage();
-            return 0;
-        }
+    const auto reply = appimagelauncher::requestDaemon({ argv + 1, argv + argc });
+    if (!reply.has_value() || reply->exitCode == appimagelauncher::kDaemonFallbackExitCode) {
+        return std::nullopt;
+    }
+    std::cout << reply->out << std::flush;
+    std::cerr << reply->err << std::flush;
+    return reply->exitCode;
+}
 
-        std::cerr << "Unknown command: " << command << std::endl;
-        printUsage();
-        return 1;
+// The library can be unusable, for example when the storage directory cannot be created.
+// Reports why in a dialog and returns nullptr then.
+std::unique_ptr<AppImageManager> openManager()
+{
+    try {
+        return std::make_unique<AppImageManager>();
     } catch (const std::exception &error) {
-        std::cerr << "Error: " << error.what() << std::endl;
-        return 1;
+        QMessageBox::critical(nullptr, QObject::tr("Unable to open the AppImage library"), QString::fromUtf8(error.what()));
+        return nullptr;
     }
 }
 
@@ -158,15 +121,18 @@ int handleOpenCommand(int argc, char *argv[])
     }
 
     const std::string target = argv[2];
-    AppImageManager manager;
+    const auto manager = openManager();
+    if (!manager) {
+        return 1;
+    }
 
-    auto entry = manager.entryById(target);
+    auto entry = manager->entryById(target);
     if (!entry.has_value()) {
         std::filesystem::path candidate(target);
         if (std::filesystem::exists(candidate)) {
-            entry = manager.entryByStoredPath(candidate);
+            entry = manager->entryByStoredPath(candidate);
             if (!entry.has_value()) {
-                entry = manager.entryByOriginalPath(candidate);
+                entry = manager->entryByOriginalPath(candidate);
             }
 
             if (!entry.has_value()) {
@@ -178,7 +144,7 @@ int handleOpenCommand(int argc, char *argv[])
 
                 if (response == QMessageBox::Yes) {
                     try {
-                        entry = manager.addAppImage(candidate, true);
+                        entry = manager->addAppImage(candidate, true);
                     } catch (const std::exception &error) {
                         QMessageBox::critical(nullptr, QObject::tr("Unable to add"), QString::fromUtf8(error.what()));
                         return 1;
@@ -202,6 +168,7 @@ int handleOpenCommand(int argc, char *argv[])
         return 1;
     }
 
+    appimagelauncher::prepareLaunch(manager->launchHistoryPath(), *entry);
     if (!QProcess::startDetached(QString::fromStdString(entry->storedPath.string()), {})) {
         QMessageBox::warning(nullptr, QObject::tr("Launch failed"), QObject::tr("Unable to start the AppImage."));
         return 1;
@@ -210,6 +177,41 @@ int handleOpenCommand(int argc, char *argv[])
     return 0;
 }
 
+int runDaemon(int argc, char *argv[])
+{
+    if (argc >= 3 && std::string(argv[2]) == "stop") {
+        const auto reply = appimagelauncher::requestDaemon({ "stop" });
+        if (!reply.has_value()) {
+            std::cerr << "No AppImage Manager daemon is running" << std::endl;
+            return 1;
+        }
+        std::cout << reply->out << std::flush;
+        std::cerr << reply->err << std::flush;
+        return reply->exitCode;
+    }
+
+    configureApplicationMetadata();
+    QApplication app(argc, argv);
+    app.setQuitOnLastWindowClosed(false);
+    Preferences preferences = Preferences::load();
+    TranslationManager translator;
+    translator.applyLanguage(preferences.language);
+
+    try {
+        AppImageManager manager;
+        LauncherDaemon daemon(manager);
+        QString error;
+        if (!daemon.listen(&error)) {
+            std::cerr << "Unable to start daemon: " << error.toStdString() << std::endl;
+            return 1;
+        }
+        return app.exec();
+    } catch (const std::exception &error) {
+        std::cerr << "Error: " << error.what() << std::endl;
+        return 1;
+    }
+}
+
 int runGui(int argc, char *argv[])
 {
     configureApplicationMetadata();
@@ -218,8 +220,11 @@ int runGui(int argc, char *argv[])
     TranslationManager translator;
     translator.applyLanguage(preferences.language);
 
-    AppImageManager manager;
-    MainWindow window(manager, translator, preferences);
+    const auto manager = openManager();
+    if (!manager) {
+        return 1;
+    }
+    MainWindow window(*manager, translator, preferences);
     window.show();
     return app.exec();
 }
@@ -228,9 +233,18 @@ int runGui(int argc, char *argv[])
 
 int main(int argc, char *argv[])
 {
+    StartupTimer timer(argc > 1 ? argv[1] : "gui");
+
     if (argc > 1) {
-        const int cliResult = handleCliCommand(argc, argv);
-        if (cliResult != -1) {
+        if (std::string(argv[1]) == "daemon") {
+            return runDaemon(argc, argv);
+        }
+        if (const auto daemonResult = forwardToDaemon(argc, argv)) {
+            return *daemonResult;
+        }
+        // Everything except "open" runs without constructing a Qt application.
+        const int cliResult = appimagelauncher::runCliCommand({ argv + 1, argv + argc }, std::cout, std::cerr);
+        if (cliResult != appimagelauncher::kRequiresQtExitCode) {
             return cliResult;
         }
         return handleOpenCommand(argc, argv);
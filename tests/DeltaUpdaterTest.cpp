@@ -0,0 +1,266 @@
+#include "AppImageManager/DeltaUpdater.h"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using appimagelauncher::buildDeltaUpdate;
+using appimagelauncher::DeltaUpdateResult;
+
+namespace {
+
+constexpr std::size_t kBlockSize = 2048;
+constexpr const char *kUpdateInformation = "zsync|https://example.org/Foo-x86_64.AppImage.zsync";
+
+int failures = 0;
+
+void check(bool condition, const std::string &what)
+{
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+}
+
+std::uint32_t rotateLeft(std::uint32_t value, int shift)
+{
+    return (value << shift) | (value >> (32 - shift));
+}
+
+// Padded the way MD4 and SHA-1 both expect, with the bit length in the given byte order.
+std::string padded(std::string message, bool bigEndian)
+{
+    const std::uint64_t bits = std::uint64_t(message.size()) * 8;
+    message += '\x80';
+    while (message.size() % 64 != 56) {
+        message += '\0';
+    }
+    for (int i = 0; i < 8; ++i) {
+        message += static_cast<char>(bits >> (bigEndian ? 56 - 8 * i : 8 * i));
+    }
+    return message;
+}
+
+std::array<unsigned char, 16> md4(const std::string &data)
+{
+    const std::string message = padded(data, false);
+    std::uint32_t h[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    static const int order2[16] = { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 };
+    static const int order3[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+    static const int shifts[3][4] = { { 3, 7, 11, 19 }, { 3, 5, 9, 13 }, { 3, 9, 11, 15 } };
+    for (std::size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        std::uint32_t x[16];
+        for (int i = 0; i < 16; ++i) {
+            const auto *p = reinterpret_cast<const unsigned char *>(message.data() + chunk + 4 * i);
+            x[i] = std::uint32_t(p[0]) | std::uint32_t(p[1]) << 8 | std::uint32_t(p[2]) << 16 | std::uint32_t(p[3]) << 24;
+        }
+        std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+        for (int round = 0; round < 3; ++round) {
+            for (int i = 0; i < 16; ++i) {
+                std::uint32_t f = 0;
+                int k = i;
+                if (round == 0) {
+                    f = (b & c) | (~b & d);
+                } else if (round == 1) {
+                    f = ((b & c) | (b & d) | (c & d)) + 0x5a827999;
+                    k = order2[i];
+                } else {
+                    f = (b ^ c ^ d) + 0x6ed9eba1;
+                    k = order3[i];
+                }
+                const std::uint32_t next = rotateLeft(a + f + x[k], shifts[round][i % 4]);
+                a = d;
+                d = c;
+                c = b;
+                b = next;
+            }
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+    }
+    std::array<unsigned char, 16> digest {};
+    for (int i = 0; i < 16; ++i) {
+        digest[i] = static_cast<unsigned char>(h[i / 4] >> (8 * (i % 4)));
+    }
+    return digest;
+}
+
+std::string sha1Hex(const std::string &data)
+{
+    const std::string message = padded(data, true);
+    std::uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+    for (std::size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        std::uint32_t w[80];
+        for (int i = 0; i < 16; ++i) {
+            const auto *p = reinterpret_cast<const unsigned char *>(message.data() + chunk + 4 * i);
+            w[i] = std::uint32_t(p[0]) << 24 | std::uint32_t(p[1]) << 16 | std::uint32_t(p[2]) << 8 | std::uint32_t(p[3]);
+        }
+        for (int i = 16; i < 80; ++i) {
+            w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        std::uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i) {
+            std::uint32_t f = 0;
+            if (i < 20) {
+                f = ((b & c) | (~b & d)) + 0x5a827999;
+            } else if (i < 40) {
+                f = (b ^ c ^ d) + 0x6ed9eba1;
+            } else if (i < 60) {
+                f = ((b & c) | (b & d) | (c & d)) + 0x8f1bbcdc;
+            } else {
+                f = (b ^ c ^ d) + 0xca62c1d6;
+            }
+            const std::uint32_t next = rotateLeft(a, 5) + f + e + w[i];
+            e = d;
+            d = c;
+            c = rotateLeft(b, 30);
+            b = a;
+            a = next;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    char hex[41];
+    for (int i = 0; i < 5; ++i) {
+        std::snprintf(hex + 8 * i, 9, "%08x", h[i]);
+    }
+    return std::string(hex, 40);
+}
+
+void writeFile(const std::filesystem::path &path, const std::string &content)
+{
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    stream << content;
+}
+
+std::string readFile(const std::filesystem::path &path)
+{
+    std::ifstream stream(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+}
+
+// What zsyncmake writes for content: headers, then a 4-byte rolling checksum and a 16-byte
+// MD4 per block, the last block zero-padded.
+void writeControlFile(const std::filesystem::path &path, const std::string &fileName, const std::string &content)
+{
+    std::string control = "zsync: 0.6.2\nFilename: " + fileName + "\nBlocksize: " + std::to_string(kBlockSize)
+        + "\nLength: " + std::to_string(content.size()) + "\nHash-Lengths: 1,4,16\nURL: " + fileName
+        + "\nSHA-1: " + sha1Hex(content) + "\n\n";
+    for (std::size_t offset = 0; offset < content.size(); offset += kBlockSize) {
+        std::string block = content.substr(offset, kBlockSize);
+        block.resize(kBlockSize, '\0');
+        std::uint16_t a = 0;
+        std::uint16_t b = 0;
+        for (std::size_t i = 0; i < block.size(); ++i) {
+            const auto byte = static_cast<unsigned char>(block[i]);
+            a = static_cast<std::uint16_t>(a + byte);
+            b = static_cast<std::uint16_t>(b + (block.size() - i) * byte);
+        }
+        control += static_cast<char>(a >> 8);
+        control += static_cast<char>(a);
+        control += static_cast<char>(b >> 8);
+        control += static_cast<char>(b);
+        const auto digest = md4(block);
+        control.append(reinterpret_cast<const char *>(digest.data()), digest.size());
+    }
+    writeFile(path, control);
+}
+
+std::string randomBytes(std::mt19937 &random, std::size_t size)
+{
+    std::string bytes(size, '\0');
+    for (auto &byte : bytes) {
+        byte = static_cast<char>(random() & 0xff);
+    }
+    return bytes;
+}
+
+// An AppImage-like file whose zero padding spans several identical blocks, like the
+// runtime's empty signature sections.
+std::string appImageLike(std::mt19937 &random)
+{
+    return randomBytes(random, 3 * kBlockSize) + std::string(4 * kBlockSize, '\0') + randomBytes(random, 5 * kBlockSize)
+        + std::string(2 * kBlockSize, '\0') + randomBytes(random, kBlockSize / 3);
+}
+
+void testCurrentFileIsUpToDate(const std::filesystem::path &root)
+{
+    std::mt19937 random(1);
+    const std::string content = appImageLike(random);
+    const std::filesystem::path mirror = root / "current-mirror";
+    std::filesystem::create_directories(mirror);
+    writeFile(root / "current.AppImage", content);
+    writeFile(mirror / "Foo-x86_64.AppImage", content);
+    writeControlFile(mirror / "Foo-x86_64.AppImage.zsync", "Foo-x86_64.AppImage", content);
+
+    // Repeated runs must keep reporting it, rather than rebuilding an identical file.
+    for (int run = 0; run < 3; ++run) {
+        const std::filesystem::path output = root / ("current-" + std::to_string(run) + ".AppImage");
+        const DeltaUpdateResult result
+            = buildDeltaUpdate(root / "current.AppImage", kUpdateInformation, "file://" + mirror.string(), output);
+        check(result.upToDate, "an AppImage with repeated zero blocks is up to date with its own control file");
+        check(!std::filesystem::exists(output), "nothing is written when the AppImage is up to date");
+    }
+}
+
+void testChangedBlocksAreFetched(const std::filesystem::path &root)
+{
+    std::mt19937 random(2);
+    const std::string current = appImageLike(random);
+    std::string target = current;
+    const std::string changed = randomBytes(random, kBlockSize);
+    target.replace(4 * kBlockSize, kBlockSize, changed);
+    target.insert(9 * kBlockSize + 100, randomBytes(random, 300));
+
+    const std::filesystem::path mirror = root / "changed-mirror";
+    std::filesystem::create_directories(mirror);
+    writeFile(root / "old.AppImage", current);
+    writeFile(mirror / "Foo-x86_64.AppImage", target);
+    writeControlFile(mirror / "Foo-x86_64.AppImage.zsync", "Foo-x86_64.AppImage", target);
+
+    const std::filesystem::path output = root / "new.AppImage";
+    const DeltaUpdateResult result
+        = buildDeltaUpdate(root / "old.AppImage", kUpdateInformation, "file://" + mirror.string(), output);
+    check(!result.upToDate, "a changed AppImage is not up to date");
+    check(readFile(output) == target, "the update reconstructs the new AppImage");
+    check(result.reusedBytes + result.fetchedBytes == target.size(), "every byte is either reused or fetched");
+    check(result.reusedBytes > result.fetchedBytes, "unchanged blocks are reused from the current AppImage");
+}
+
+} // namespace
+
+int main()
+{
+    char pattern[] = "/tmp/deltaupdater-test-XXXXXX";
+    if (!::mkdtemp(pattern)) {
+        std::cerr << "Unable to create a temporary directory" << std::endl;
+        return 1;
+    }
+    const std::filesystem::path root(pattern);
+
+    try {
+        testCurrentFileIsUpToDate(root);
+        testChangedBlocksAreFetched(root);
+    } catch (const std::exception &error) {
+        std::cerr << "FAIL: " << error.what() << std::endl;
+        ++failures;
+    }
+
+    std::filesystem::remove_all(root);
+    return failures == 0 ? 0 : 1;
+}